@@ -1,4 +1,5 @@
 #include "AES.h"
+#include "LoraProf.h"
 #include <stdlib.h>
 
 /*
@@ -320,6 +321,7 @@ void AES::clean ()
 
 byte AES::encrypt_buff (byte * plain, int n_block)
 {
+  PROF_SCOPE(ProfAesEnc);
   byte *iv=(byte*)calloc(N_BLOCK,1);
   while (n_block--)
     {
@@ -338,6 +340,7 @@ byte AES::encrypt_buff (byte * plain, int n_block)
 
 byte AES::decrypt_buff (byte * cipher,int n_block)
 { 
+  PROF_SCOPE(ProfAesDec);
   byte *iv=(byte*)calloc(N_BLOCK,1); 
   while (n_block--)
     {
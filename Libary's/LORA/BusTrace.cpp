@@ -0,0 +1,32 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "BusTrace.h"
+
+BusTrace::BusTrace(unsigned int len):TraceRing(len){on=true;}
+BusTrace::BusTrace():TraceRing(defTraceLen){on=true;}
+
+void BusTrace::start(){on=true;}
+void BusTrace::stop(){on=false;}
+
+void BusTrace::record(byte bus,byte addr,unsigned int len)
+{
+  if (on) add(bus,addr,len);
+}
+
+void BusTrace::dump()
+{
+  bool was=on;
+  on=false;
+  print("BT");
+  on=was;
+}
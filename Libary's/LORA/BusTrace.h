@@ -0,0 +1,72 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class BusTrace.
+*  Optional trace of bus transactions (SPI of SX1278, I2C of display): every
+*  transaction is stored as a compact 8 bytes record (time us, bus and 
+*  direction, register or device address, bytes) in a ring buffer (the 
+*  oldest records are overwritten) and the buffer can be dumped on Serial.
+*  Buffer and dump ("BT:" lines, 16 hex digits ttttttttbbaallll per record) 
+*  are TraceRing ones.
+*  extras/LoraSim/TraceReplay.cpp reads a dump (copied from serial monitor) 
+*  and reports transactions, bytes and modelled bus time.
+*  Use: BusTrace BT(256); SX.setTrace(&BT); 
+*       display.setTraceHook(i2cTrace);  (i2cTrace calls BT.record(BusI2C,..))
+*  The SX1278 hook (SX.setTrace) is compiled only with LORA_BUSTRACE defined
+*  (build flag -DLORA_BUSTRACE or uncommenting the line below); otherwise SPI
+*  transactions have no trace code at all.
+*/
+
+#ifndef BusTrace_h
+#define BusTrace_h
+
+#include <Arduino.h>
+#include "TraceRing.h"
+
+//#define LORA_BUSTRACE
+
+#define BusSPI      1            //bus codes (low nibble)
+#define BusI2C      2
+#define TraceRead   0x80         //read transaction flag
+#define defTraceLen 128          //default records
+
+typedef TraceRecord BusRecord;  //t, bus (code | TraceRead), addr, len
+
+class BusTrace : public TraceRing
+{
+  public:
+  
+/* Ring buffer of len records (rounded to power of 2) */  
+  BusTrace(unsigned int len);
+  BusTrace();
+  
+/* Add a record (if started) */  
+  void record(byte bus,byte addr,unsigned int len);
+/* Start/stop recording (started by constructor).
+   count(), getLost(), get(i), clear(): see TraceRing */  
+  void start();
+  void stop();
+/* Print buffer on Serial (see format) and clear it */  
+  void dump();
+
+  private:
+  bool on;
+};
+
+#ifdef LORA_BUSTRACE
+#define BUS_TRACE(tr,bus,addr,len) if (tr) tr->record(bus,addr,len)
+#else
+#define BUS_TRACE(tr,bus,addr,len)
+#endif
+
+#endif
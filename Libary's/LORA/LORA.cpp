@@ -40,17 +40,39 @@
 */
 
 #include <LORA.h>
+#include <LoraTrace.h>
+#include <LoraWatch.h>
 
 
 /******* With AES256 cryptography and sender/destination addresses ***********/
 
 /********* Initializing ********/
 
+LORA::LORA()
+{
+  zip=false;
+  duty=NULL;
+  prio=false;
+  hop=NULL;
+  afc=NULL;
+  peers=NULL;
+  seqOn=false;
+  retry=false;
+  dupAck=false;
+  txSeq=0;
+  seq=0;
+  held.mess=NULL;
+  resetStats();
+  afcPeer=0;
+  ackSF=0;
+}
+
 /* Start shield in LoRa mode and prepare 32 bytes key for AES256 crypto*/
 bool LORA::begin(unsigned int keyval)
 {
   if (!begin()) return false;
   SX.createKey(keyval);
+  txSeq=random(0x10000);
   return true;
 }
 
@@ -62,6 +84,19 @@ void LORA::setModeLora(unsigned int keyval)
   SX.createKey(keyval);
 }
 
+bool LORA::beginWarm(unsigned int sig,unsigned int keyval)
+{
+  if (sig==0) return false;
+  if (!SX.beginWarm()) return false;
+  if (SX.configSignature()!=sig) return false;     //LoRa mode bit included
+  SX.setState(STDBY);
+  SX.createKey(keyval);
+  txSeq=random(0x10000);
+  return true;
+}
+
+unsigned int LORA::getSignature(){return SX.configSignature();}
+
 /* Define net structure. This function must be called before defNetAddress
 *  Code has to be from 2 to 14 and is the exponent of power of 2.
 *  Device address address range will be from 1 and 2^code -1. 0 address is 
@@ -84,7 +119,7 @@ int LORA::defDevRange(unsigned char code)
   if (code>14) return -1;
   r2p=code;         // mask : (2^r2p -1)
   mask=(1<<r2p)-1;  //ex: r2p=7 -> mask=0x007F (00000000 01111111) range:1-127
-  netmask=~mask;  //ex: 11111111 10000000
+  netmask=(~mask)&0xFFFF;  //ex: 11111111 10000000 (16 bits also where int is 32)
   maxnetadd=netmask>>r2p;  //ex: maxnet=0000001 11111111
   return maxnetadd;
 }
@@ -102,6 +137,7 @@ bool LORA::defNetAddress(unsigned int add)
 {
    if (add>maxnetadd) return false;
    netAddress=add<<r2p;
+   return true;
 }
 
 /********** Sending ***********/
@@ -124,14 +160,143 @@ int LORA::sendNetMess(unsigned int toSubAdd, unsigned int fromSubAdd, byte *mess
 {
   unsigned int destAdd=netAddress|toSubAdd;
   unsigned int sendAdd=netAddress|fromSubAdd;
+  afcPeer=toSubAdd;
   return sendMess(destAdd,sendAdd,mess,lmess);
 }
 
+int LORA::sendNetMess(unsigned int toSubAdd, unsigned int fromSubAdd, byte *mess, int lmess, byte flags)
+{
+  unsigned int destAdd=netAddress|toSubAdd;
+  unsigned int sendAdd=netAddress|fromSubAdd;
+  afcPeer=toSubAdd;
+  return sendMess(destAdd,sendAdd,mess,lmess,flags);
+}
+
 int LORA::sendNetMess(unsigned int toSubAdd, unsigned int fromSubAdd, char* mess)
 {
   int lmess=strlen(mess);
-  sendNetMess(toSubAdd, fromSubAdd, (byte*) mess, lmess);
+  return sendNetMess(toSubAdd, fromSubAdd, (byte*) mess, lmess);
+}
+/* Set on/off compression of messages before encryption (def.: off) */
+void LORA::setCompression(boolean on){zip=on;}
+
+/* Attach an airtime accountant for duty cycle limits (NULL: none) */
+void LORA::setDutyCycle(LoraDuty* dc){duty=dc;}
+
+void LORA::setHopping(LoraHop* hp){hop=hp;if (hop!=NULL) hop->restart();}
+
+void LORA::setAfc(LoraAfc* af)
+{
+  afc=af;
+  if (afc==NULL) SX.setFreqCorr(0); else afc->usePeers(peers);
+}
+
+/* Temperature reading needs SLEEP and FSK mode: never in receiving mode */
+void LORA::update()
+{
+  if ((afc==NULL)||!afc->tempDue()) return;
+  if ((SX.readMode()!=loramode)||(SX.readState()!=STDBY)) return;
+  afc->sampleTemp();
+}
+
+void LORA::setPeers(LoraPeers* tb){peers=tb;if (afc!=NULL) afc->usePeers(peers);}
+
+void LORA::setSequence(boolean on){seqOn=on;}
+void LORA::setRetry(boolean on){retry=on;}
+unsigned int LORA::getSeq(){return seq;}
+void LORA::setDupAck(boolean on){dupAck=on;}
+unsigned long LORA::getDuplicates(){return st.rxDups;}
+
+LoraStats* LORA::getStats(){return &st;}
+
+void LORA::snapshotStats(LoraStats* s)
+{
+  LoraStats t;
+  do {memcpy(s,&st,sizeof(LoraStats));memcpy(&t,&st,sizeof(LoraStats));}
+  while (memcmp(s,&t,sizeof(LoraStats))!=0);
+}
+
+void LORA::resetStats(){memset(&st,0,sizeof(LoraStats));airUs=0;}
+
+int LORA::exportStats(byte* buff,int len)
+{
+  int n=sizeof(LoraStats)/sizeof(unsigned long);
+  if (len<3+4*n) return 0;
+  LoraStats s;
+  snapshotStats(&s);
+  unsigned long* v=(unsigned long*)&s;
+  buff[0]='L';buff[1]=statVersion;buff[2]=n;
+  for (int i=0;i<n;i++) 
+    {buff[3+4*i]=v[i]&0xFF;buff[4+4*i]=(v[i]>>8)&0xFF;buff[5+4*i]=(v[i]>>16)&0xFF;buff[6+4*i]=(v[i]>>24)&0xFF;}
+  return 3+4*n;
+}
+
+/* Window of last seqWindow sequence numbers as bitmap (bit i: seq-1-i).
+   A jump back over the window is taken as sender restart */
+boolean LORA::seqCheck(LoraPeer* p)
+{
+  if (!p->seqOk) {p->seq=seq;p->seqMap=0;p->seqOk=1;return true;}
+  int d=(int)(int16_t)(seq-p->seq);
+  if (d==0) return false;
+  if (d>0) 
+  {
+    if (d>=seqWindow) p->seqMap=0; 
+    else p->seqMap=(p->seqMap<<d)|(1UL<<(d-1));
+    p->seq=seq;
+    return true;
+  }
+  d=-d;
+  if (d>seqWindow) {p->seq=seq;p->seqMap=0;return true;}
+  if (bitRead(p->seqMap,d-1)) return false;
+  bitSet(p->seqMap,d-1);
+  return true;
+}
+
+LoraPeer* LORA::getPeer(unsigned int subAdd){return getPeer(subAdd,false);}
+
+LoraPeer* LORA::getPeer(unsigned int subAdd,boolean add)
+{
+  if (peers==NULL) return NULL;
+  return add?peers->add(subAdd):peers->get(subAdd);
+}
+
+/* Radio in standby: apply frequency correction for afcPeer and go to the
+   first hopping channel */
+void LORA::tune()
+{
+  if (afc!=NULL) SX.setFreqCorr(afc->getOffset(afcPeer));
+  afcPeer=0;
+  if (hop!=NULL) hop->restart();
+}
+
+/* Delay of wait loops: channel changes are made here while hopping */
+void LORA::pause(unsigned long ms){if (hop!=NULL) hop->wait(ms); else delay(ms);}
+
+/* Next transmissions are high priority (they can use reserved budget) */
+void LORA::setPriority(boolean high){prio=high;}
+
+/* Airtime (microseconds) available on current frequency */
+unsigned long LORA::getAirBudget()
+{
+  if (duty==NULL) return 0xFFFFFFFFUL;
+  return duty->remaining(SX.readFreqHz(),prio);
+}
+
+/* Milliseconds to wait before a message lmess bytes long can be sent */
+unsigned long LORA::getDutyWait(int lmess)
+{
+  if (duty==NULL) return 0;
+  return duty->waitTime(SX.readFreqHz(),SX.getLoraTimeOnAir(getFrameLen(lmess)),prio);
+}
+
+
+/* Length of the frame sent on air for a message lmess bytes long */
+int LORA::getFrameLen(int lmess)
+{
+  int hdr=seqOn?5:3;
+  return 2+((lmess+hdr+15)/16)*16;
 }
+
 /*********** Receiving **********/
 
 /*
@@ -152,15 +317,22 @@ int LORA::receiveNextMessage(unsigned int toSubAdd, unsigned int fromSubAdd, byt
 //  SX.setLoraRxTimeout((float)tout/1000);
   SX.setState(STDBY);
   SX.clearAllLoraFlag(); 
+  afcPeer=fromSubAdd;
+  tune();
   SX.setState(FSRX);
 //  SX.setState(RXSING);
   SX.setState(RXCONT);
     for (int i=0;i<n;i=i+inc) 
     {
       if (SX.getLoraFlag(RxDone)) 
-         {messlen=receiveNetMess(toSubAdd,fromSubAdd,buff,maxlen);if (messlen>0) break;}
+      {
+        messlen=receiveNetMess(toSubAdd,fromSubAdd,buff,maxlen);
+        if (messlen>0) break;
+        if ((messlen==-3)&&dupAck&&(subNetDestAddress!=0)&&!(marker&MarkCtrl))
+          {sendAck(subNetSenderAddress,toSubAdd);SX.setState(FSRX);SX.setState(RXCONT);}
+      }
 //      if (SX.getLoraFlag(RxTimeout)){ break;}
-      delay(10);
+      pause(10);
      } 
   SX.setState(STDBY);
   SX.clearAllLoraFlag();
@@ -174,6 +346,7 @@ void LORA::receiveMessMode()
 {
   SX.setState(STDBY);
   SX.clearAllLoraFlag();  
+  tune();
   SX.setState(FSRX);
   SX.setState(RXCONT);
 }
@@ -198,14 +371,30 @@ int LORA::receiveNetMess(unsigned int toSubAdd, unsigned int fromSubAdd, byte *b
   int len=0;
   if ((len=dataRead(buff,maxlen))<=0) return 0;
   unsigned int add=word(buff[0],buff[1]);
-  if ((add&netmask) != netAddress) return 0;
+  if ((add&netmask) != netAddress) {st.rxForeign++;return 0;}
   unsigned int dest=add&mask;
-  if (dest!=0) {if (dest!=toSubAdd) return 0;} 
-  decodeMess(buff,len);
+  if (dest!=0) {if (dest!=toSubAdd) {st.rxForeign++;return 0;}} 
+  subNetDestAddress=dest;
+  if (decodeMess(buff,len)<0) {st.rxForeign++;return -4;}
   unsigned int senderNet=senderAddress & netmask;
-  if (senderNet!=netAddress) return -2; 
+  if (senderNet!=netAddress) {st.rxForeign++;return -2;}
   subNetSenderAddress=senderAddress & mask;
+  int rssi=SX.lastLoraPacketRssi();
+  int snr=SX.lastLoraPacketSnr();
+  if (afc!=NULL) afc->update(subNetSenderAddress,SX.lastLoraPacketFreqErr()+SX.getFreqCorr());
+  LoraPeer* p=NULL;
+  if (peers!=NULL) p=peers->add(subNetSenderAddress);
+  if (p!=NULL) {p->seen=millis();p->rssi=rssi+100;p->snr=snr;}
   if (fromSubAdd!=0) {if (subNetSenderAddress!=fromSubAdd) return -1;}
+  if (p!=NULL)                           //sequence taken only if delivered
+  {
+    if ((marker&MarkSeq)&&!seqCheck(p)) {st.rxDups++;return -3;}
+    p->rx++;
+  }
+  st.rxMess++;
+  st.rssi=rssi;st.snr=snr;
+  st.rssiHist[constrain((rssi+140)/10,0,statBins-1)]++;
+  st.snrHist[constrain((snr+20)/4,0,statBins-1)]++;
   return receivedMessLen;
 }
 
@@ -224,6 +413,131 @@ return (char*)receivedMessage;}
 
 byte LORA::getMarker(){return marker;}
 
+unsigned long LORA::getAckTag(){return ((unsigned long)marker<<16)|((marker&MarkSeq)?seq:0);}
+
+/* Get destination sub-address of last message received (0 if broadcast) */
+unsigned int LORA::getDest(){return subNetDestAddress;}
+
+boolean LORA::holdMess()
+{
+  if ((held.mess!=NULL)||(receivedMessLen<=0)) return false;
+  held.mess=new byte[receivedMessLen];
+  memcpy(held.mess,receivedMessage,receivedMessLen);
+  held.len=receivedMessLen;
+  held.sender=senderAddress;held.subSender=subNetSenderAddress;
+  held.dest=subNetDestAddress;held.seq=seq;held.marker=marker;
+  return true;
+}
+
+/* Message is restored in unzBuff (it fits any message) */
+int LORA::takeHeldMess(unsigned int fromSubAdd)
+{
+  if (held.mess==NULL) return 0;
+  if ((fromSubAdd!=0)&&(held.subSender!=fromSubAdd)) return 0;
+  memcpy(unzBuff,held.mess,held.len);
+  unzBuff[held.len]=0;
+  delete[] held.mess;
+  held.mess=NULL;
+  receivedMessage=unzBuff;
+  receivedMessLen=held.len;
+  senderAddress=held.sender;subNetSenderAddress=held.subSender;
+  subNetDestAddress=held.dest;seq=held.seq;marker=held.marker;
+  return receivedMessLen;
+}
+
+/******** Implicit header frames and acknowledges **************/
+
+int LORA::sendImplicit(byte mess[],byte len,byte sf)
+{
+  SXFrameCfg dc;
+  SX.setState(STDBY);
+  SX.getLoraFrameCfg(dc);
+  SX.setLoraFrameCfg(SX.implicitCfg(dc,len,sf));
+  int ret=sendMess(mess,len);
+  SX.setLoraFrameCfg(dc);
+  return ret;
+}
+
+int LORA::receiveImplicit(byte buff[],byte len,byte sf,int tout)
+{
+  SXFrameCfg dc;
+  SX.setState(STDBY);
+  SX.getLoraFrameCfg(dc);
+  SX.setLoraFrameCfg(SX.implicitCfg(dc,len,sf));
+  receiveMessMode();
+  int nc=0;
+  unsigned long t=millis();
+  while ((nc=dataRead(buff,len))==0) 
+    {if (millis()-t>=(unsigned long)tout) break; pause(1);}
+  SX.setState(STDBY);
+  SX.setLoraFrameCfg(dc);
+  return nc;
+}
+
+void LORA::setAckSprFactor(byte sf){ackSF=sf;}
+
+/* Check: 16 bits of the block (addresses, marker, sequence number) encrypted 
+   with the key. Without key an acknowledge can't be forged, and an old one 
+   doesn't match a new message (sequence number or random marker bits) */
+unsigned int LORA::ackCheck(unsigned int destAdd,unsigned int sendAdd,unsigned long tag)
+{
+  byte b[16];
+  memset(b,0,16);
+  b[0]=highByte(destAdd);b[1]=lowByte(destAdd);
+  b[2]=highByte(sendAdd);b[3]=lowByte(sendAdd);
+  b[4]=(tag>>16)&0xFF;b[5]=(tag>>8)&0xFF;b[6]=tag&0xFF;
+  b[15]=0xAC;
+  SX.encryptBuff(b,1);
+  return word(b[0],b[1]);
+}
+
+int LORA::sendAck(unsigned int toSubAdd, unsigned int fromSubAdd)
+{return sendAck(toSubAdd,fromSubAdd,getAckTag());}
+
+bool LORA::waitAck(unsigned int toSubAdd, unsigned int fromSubAdd,int tout)
+{return waitAck(toSubAdd,fromSubAdd,getAckTag(),tout);}
+
+int LORA::sendAck(unsigned int toSubAdd, unsigned int fromSubAdd, unsigned long tag)
+{
+  unsigned int destAdd=netAddress|toSubAdd;
+  unsigned int sendAdd=netAddress|fromSubAdd;
+  byte ack[ackFrameLen];
+  ack[0]=highByte(destAdd);ack[1]=lowByte(destAdd);
+  ack[2]=highByte(sendAdd);ack[3]=lowByte(sendAdd);
+  unsigned int c=ackCheck(destAdd,sendAdd,tag);
+  ack[4]=highByte(c);ack[5]=lowByte(c);
+  afcPeer=toSubAdd;
+  st.ackSent++;
+  boolean p=prio;
+  prio=true;
+  int ret=sendImplicit(ack,ackFrameLen,ackSF);
+  prio=p;
+  return ret;
+}
+
+bool LORA::waitAck(unsigned int toSubAdd, unsigned int fromSubAdd, unsigned long tag, int tout)
+{
+  WATCH_SCOPE(WatchWaitAck);
+  unsigned int destAdd=netAddress|toSubAdd;
+  unsigned int sendAdd=netAddress|fromSubAdd;
+  byte ack[ackFrameLen];
+  unsigned int c=ackCheck(destAdd,sendAdd,tag);
+  unsigned long t=millis();
+  long w;
+  traceEvent(EvAckWait,0,fromSubAdd);
+  while ((w=tout-(long)(millis()-t))>0)
+  {
+    afcPeer=fromSubAdd;
+    if (receiveImplicit(ack,ackFrameLen,ackSF,w)<ackFrameLen) continue;
+    if (word(ack[0],ack[1])!=destAdd) continue;
+    if (word(ack[2],ack[3])!=sendAdd) continue;
+    if (word(ack[4],ack[5])==c) {st.ackOk++;traceEvent(EvAckOk,0,fromSubAdd);return true;}
+  }
+  st.ackTimeout++;
+  traceEvent(EvAckTout,0,fromSubAdd);
+  return false;
+}
+
 /********* Utility **********/
 
 /* For convenience. Equivalent to SX.setPower 
@@ -238,7 +552,8 @@ byte LORA::getMarker(){return marker;}
 /* For convenience. Equivalent to SX.setFreq 
 *  The parameter freq is in MHz Ex.: 433.93 (default 434.0)
 */ 
-  void LORA::setFrequency(float freq){SX.setFreq(freq);}  
+  void LORA::setFrequency(float freq){SX.setFreq(freq);}
+  void LORA::setFrequencyHz(unsigned long hz){SX.setFreqHz(hz);}  
   
 /* For convenience. Like SX.setState(state).
 *  If yes==true radio module goes in lowest power state.
@@ -251,18 +566,30 @@ byte LORA::getMarker(){return marker;}
     else SX.setState(STDBY);
   }
   
-void LORA::decodeMess(byte *buff,int len)
+/* It returns message length or -1 if frame is shorter than a block or 
+   compressed message can't be inflated (frame must be discarded) */
+int LORA::decodeMess(byte *buff,int len)
 {
   int lenEnc=len-2;
   byte *buffEnc=&buff[2];
+  if (lenEnc<16) {receivedMessLen=0;return -1;}
   int nbk=int(ceil((float)lenEnc/16));
   
   SX.decryptBuff(buffEnc,nbk);
   
   marker=buffEnc[0];
   senderAddress=word(buffEnc[1],buffEnc[2]);
-  receivedMessage=&buffEnc[3];
-  receivedMessLen=lenEnc-3;  
+  int hdr=3;
+  if (marker&MarkSeq) {seq=word(buffEnc[3],buffEnc[4]);hdr=5;}
+  receivedMessage=&buffEnc[hdr];
+  receivedMessLen=lenEnc-hdr;  
+  if (!(marker&MarkZip)) return receivedMessLen;
+  int ulen=LoraLZ::decompress(receivedMessage,receivedMessLen,unzBuff,lzMaxLen);
+  if (ulen<0) {receivedMessLen=0;return -1;}
+  unzBuff[ulen]=0;
+  receivedMessage=unzBuff;
+  receivedMessLen=ulen;
+  return ulen;
 }
   
 
@@ -299,23 +626,40 @@ int LORA::sendMess(char mess[])
 
 int LORA::sendMess(byte mess[],byte mlen)
 {
+  WATCH_SCOPE(WatchSendMess);
+  unsigned long hz=0;
+  unsigned long toa=0;
   SX.setState(STDBY);
+  tune();
+  if (duty!=NULL)
+  {
+    hz=SX.readFreqHz();
+    toa=SX.getLoraTimeOnAir(mlen);
+    if (duty->waitTime(hz,toa,prio)>0) {st.txDuty++;return -2;}
+  }
   SX.clearLoraFlag(TxDone);  
   SX.setState(FSTX);
   delayMicroseconds(100); 
   SX.setLoraDataToSend(mess,mlen);
-//unsigned long t=millis();   
+  unsigned long t=millis();   
+  traceEvent(EvTx,0,mlen);
   SX.setState(TX);
   delayMicroseconds(100);
   unsigned long i;
   unsigned long n=(unsigned long)(mlen*2+SX.getLoraPreambleLen()+8)*10000/SX.getLorabps()+40;
   for(i=0;i<n;i++) 
-  {if (SX.getLoraFlag(TxDone))  break; else delay(1);}
+  {if (SX.getLoraFlag(TxDone))  break; else pause(1);}
+  traceEvent((i<n)?EvTxDone:EvTxFail,0,millis()-t);
 //unsigned long te=millis();  
 //Serial.print(i);Serial.print("/");Serial.print(n);Serial.print("Transmission time: ");Serial.println(te-t);   
   SX.setState(STDBY);
-  if (i<n) return 0;
-  else return -1;
+  if (hop!=NULL) hop->restart();
+  st.txFrames++;
+  if (i>=n) {st.txFail++;return -1;}
+  if (duty!=NULL) duty->charge(hz,toa);
+  airUs+=(toa>0)?toa:SX.getLoraTimeOnAir(mlen);
+  st.txAirMs+=airUs/1000;airUs%=1000;
+  return 0;
 }
 
 /*** continuous receiving mode ***/
@@ -329,11 +673,16 @@ int LORA::dataRead(char mess[],byte maxlen)
 /* Buff is a byte array and is not null terminated */
 int LORA::dataRead(byte buff[],byte blen)
 {
+  if (hop!=NULL) hop->service();
   if (!SX.getLoraFlag(RxDone)) return 0;
   if (SX.getLoraFlag(RxTimeout)) return -1;
-  if (SX.getLoraFlag(PayloadCrcError)) {SX.discardLoraRx();return -2;}
+  if (hop!=NULL) hop->restart();
+  st.rxFrames++;
+  if (SX.getLoraFlag(PayloadCrcError)) {st.rxCrcErr++;traceEvent(EvRx,1,0);SX.discardLoraRx();return -2;}
   SX.clearAllLoraFlag();
-  return SX.readLoraData(buff,blen);
+  int n=SX.readLoraData(buff,blen);
+  traceEvent(EvRx,0,n);
+  return n;
 }
 
 /*** single packet receiving mode ***/
@@ -345,6 +694,7 @@ int LORA::waitForMess(char mess[],byte mlen, float sec)
 
 int LORA::waitForMess(byte buff[],byte blen, float sec)
 {
+  WATCH_SCOPE(WatchWaitForMess);
   if (!CADmonitor(sec)) return 0;
   SX.setLoraRxByteTout(300);
   SX.clearAllLoraFlag();
@@ -353,7 +703,7 @@ int LORA::waitForMess(byte buff[],byte blen, float sec)
   int fend=-1;
   int i;
   for (i=0;i<100;i++)
-  {if ((fend=SX.getLoraRxEndFlag())==0) delay(100); else break;}
+  {if ((fend=SX.getLoraRxEndFlag())==0) pause(100); else break;}
   SX.setState(STDBY);
   if (fend<=0) return -1; 
   if (SX.getLoraFlag(PayloadCrcError)) {SX.discardLoraRx();return -2;}
@@ -363,6 +713,7 @@ int LORA::waitForMess(byte buff[],byte blen, float sec)
 /* Monitor channel waiting for sec seconds. Return true if preamble is detected */
 bool LORA::CADmonitor(float sec)
 {
+  WATCH_SCOPE(WatchCadMonitor);
   SX.setState(STDBY);
   SX.clearAllLoraFlag();
   bool f=false;
@@ -453,19 +804,37 @@ bool LORA::setNetAddress(unsigned int netAdd, unsigned int devRange)
 */
 int LORA::sendMess(unsigned int destAdd, unsigned int sendAdd, byte *mess, int lmess)
 {
-  int lenEnc=lmess+2+1;                  //len of buffer segment to encode 
+  return sendMess(destAdd,sendAdd,mess,lmess,0);
+}
+
+/* As above, but marker high bits are set to flags (ex.: MarkCtrl) */
+int LORA::sendMess(unsigned int destAdd, unsigned int sendAdd, byte *mess, int lmess, byte flags)
+{
+  int hdr=seqOn?5:3;                     //marker, sender (, sequence)
+  int lenEnc=lmess+hdr;                  //len of buffer segment to encode 
   int nbk=int(ceil((float)lenEnc/16));
   lenEnc=nbk*16;
   int lenBuff=lenEnc+2;                  //len of total buffer to send
   byte *buff=(byte *)calloc(lenBuff,1);  //buffer to send
   buff[0]=highByte(destAdd);buff[1]=lowByte(destAdd);  //dest address plain
   byte *buffEnc=&buff[2];                //buffer segment to encode
+  byte *buffMess=&buffEnc[hdr];          //message segment
+  
+  int lzip=-1;                           //compressed if it saves blocks 
+  if (zip&&(lmess>lzMinMatch)) lzip=LoraLZ::compress(mess,lmess,buffMess,lmess-1);
+  if ((lzip>0)&&((lzip+hdr+15)/16<nbk)) 
+  {
+    flags|=MarkZip;
+    nbk=(lzip+hdr+15)/16;
+    lenBuff=nbk*16+2;
+  }
+  else memcpy(buffMess,mess,lmess);      //fill with message
   
-  marker=random(256);
+  if (seqOn) {flags|=MarkSeq;seq=retry?txSeq:++txSeq;buffEnc[3]=highByte(seq);buffEnc[4]=lowByte(seq);}
+  retry=false;
+  marker=(random(256)&MarkRandom)|flags;
   buffEnc[0]=marker;                     //just to make message univocal
   buffEnc[1]=highByte(sendAdd);buffEnc[2]=lowByte(sendAdd); //sender address
-  byte *buffMess=&buffEnc[3];            //message segment
-  memcpy(buffMess,mess,lmess);           //fill with message
   if (SX.encryptBuff(buffEnc,nbk)==NULL) Serial.println("Errore!!!");
   int ret=sendMess(buff,lenBuff);
   free(buff);
@@ -497,7 +866,7 @@ int LORA::receiveMess(unsigned int destAdd, unsigned int sendAdd, byte *buff, by
    if (buff[0]!=highByte(destAdd)) return 0;
    if (buff[1]!=lowByte(destAdd)) return 0;
   }
-  decodeMess(buff,len);
+  if (decodeMess(buff,len)<0) return 0;
   if (sendAdd!=0) {if (senderAddress!=sendAdd) return -1;}
   return len-5;
 }
@@ -31,9 +31,65 @@
 #define LORA_h
 
 #include <SX1278.h>
+#include <LoraLZ.h>
+#include <LoraDuty.h>
+#include <LoraHop.h>
+#include <LoraAfc.h>
+#include <LoraPeers.h>
 
 #define LoraTxTimeout 2000
 
+/* Marker byte: high bits qualify the frame, the other bits are random */
+#define MarkCtrl    0x80   //message starts with a LoraNode control code
+#define MarkZip     0x40   //message is compressed (LoraLZ)
+#define MarkSeq     0x20   //sequence number follows sender address
+#define MarkRandom  0x1F   //random part of marker
+
+#define seqWindow   32     //sequence numbers checked for duplicates before last
+
+#define ackFrameLen 6      //implicit header acknowledge: dest(2) sender(2) check(2)
+#define statBins    8      //bins of RSSI and SNR histograms
+#define statVersion 1      //binary export format version
+
+/* Link and MAC counters (LORA and LoraNode) and gauges. All fields are long
+   (binary export: field i at offset 3+4*i) */
+struct LoraStats
+{
+  unsigned long txFrames;        //frames sent (messages and acknowledges)
+  unsigned long txFail;          //frames not completed (no TxDone)
+  unsigned long txDuty;          //frames not sent (duty cycle budget)
+  unsigned long txAirMs;         //cumulative airtime (ms)
+  unsigned long rxFrames;        //frames received (CRC errors included)
+  unsigned long rxCrcErr;        //payload CRC errors
+  unsigned long rxForeign;       //frames of other networks or nodes
+  unsigned long rxMess;          //messages accepted
+  unsigned long rxDups;          //duplicates discarded
+  unsigned long ackSent;         //acknowledges sent
+  unsigned long ackOk;           //acknowledges received
+  unsigned long ackTimeout;      //acknowledges not received in time
+  unsigned long macTx;           //LoraNode messages waiting acknowledge
+  unsigned long macRetry;        //  sent to a node after a failure
+  unsigned long cadRuns;         //LoraNode channel activity detections
+  unsigned long cadBusy;         //  finding channel busy (send deferred)
+  unsigned long cadGiveUp;       //messages not sent (channel busy until timeout)
+  long rssi;                     //last message RSSI (dBm)
+  long snr;                      //last message SNR (dB)
+  unsigned long rssiHist[statBins];  //RSSI: <-130, 10 dB bins, >=-70 dBm
+  unsigned long snrHist[statBins];   //SNR: <-16, 4 dB bins, >=8 dB
+};
+
+/* Message kept by holdMess() */
+struct LoraHeld
+{
+  byte* mess;                    //NULL if none
+  int len;
+  unsigned int sender;
+  unsigned int subSender;
+  unsigned int dest;
+  uint16_t seq;
+  byte marker;
+};
+
 class LORA
 {
   public:
@@ -42,11 +98,21 @@ class LORA
   
 /**** Initialize ***/
 
+  LORA();
+
 /* Start shield in LoRa mode and prepare 32 byte key for AES256 crypto*/
   bool begin(unsigned int keyval);
 /* Change shield in LoRa mode, if it was already started in different mode
    with AES256 key creation */
   void setModeLora(unsigned int keyval);
+/* Warm start after MCU deep sleep (radio kept powered, in SLEEP): if radio
+   configuration signature is sig (getSignature() after a cold start, kept 
+   ex. in ESP32 RTC memory) reset and configuration are skipped and radio 
+   goes to STDBY (less than 1 ms). It returns false if signature differs (or
+   sig is 0) or shield is not available: then use begin(keyval) */
+  bool beginWarm(unsigned int sig,unsigned int keyval);
+/* Signature of current radio configuration (SX.configSignature()) */
+  unsigned int getSignature();
 
 /****** Define network structure **********/
   
@@ -96,6 +162,76 @@ class LORA
 */
   int sendNetMess(unsigned int toSubAdd, unsigned int fromSubAdd, char* mess);
   int sendNetMess(unsigned int destLocalAdd, unsigned int sendLocalAdd, byte *mess, int lmess);
+/* As above, but marker high bits are set to flags (ex.: MarkCtrl) */  
+  int sendNetMess(unsigned int destLocalAdd, unsigned int sendLocalAdd, byte *mess, int lmess, byte flags);
+
+/* Length of the frame sent on air for a message lmess bytes long 
+   (plain destination + encrypted marker, sender and message blocks) */
+  int getFrameLen(int lmess);
+
+/* Set on/off compression of messages before encryption (def.: off).
+*  Message is sent compressed (marker flag MarkZip) just if it is shorter.
+*  Compressed messages are always inflated by receiver */
+  void setCompression(boolean on);
+
+/* Attach an airtime accountant for duty cycle limits (NULL: none, def.).
+*  Transmission that exceeds budget is not done (no wait): sending functions
+*  return -2 (use getDutyWait to defer it). Acknowledges are high priority */
+  void setDutyCycle(LoraDuty* dc);
+/* Next transmissions are high priority (ex.: acknowledges): they can use the
+*  budget reserved by the accountant */  
+  void setPriority(boolean high);
+/* Airtime (microseconds) available on current frequency (0xFFFFFFFF if no limit)*/
+  unsigned long getAirBudget();
+/* Milliseconds to wait before a message lmess bytes long can be sent */  
+  unsigned long getDutyWait(int lmess);
+
+/* Attach frequency hopping (NULL: none, def.). Hop (LoraHop) must be started
+*  with begin(); every packet sent or received starts on its first channel */
+  void setHopping(LoraHop* hp);
+
+/* Attach automatic frequency correction (NULL: none, def.). Frequency error
+*  of every message received is averaged per sender and used to correct the
+*  frequency when sending to it (or receiving from it) */
+  void setAfc(LoraAfc* af);
+/* Idle work, call it in the loop: board temperature for frequency correction
+*  (every minute, only if radio is in LoRa standby) */
+  void update();
+
+/* Attach peer table (NULL: none, def.). Every message received updates the 
+*  record of its sender (time, RSSI, SNR, count); frequency correction keeps 
+*  its offsets there too */
+  void setPeers(LoraPeers* tb);
+/* Record of peer (local address) or NULL; add: created if not in table */  
+  LoraPeer* getPeer(unsigned int subAdd);
+  LoraPeer* getPeer(unsigned int subAdd,boolean add);
+
+/* Send 16 bits sequence number with every message (def.: off; frames with
+*  it are not understood by nodes without it). With a peer table, messages 
+*  already received (same sender and sequence) are discarded */
+  void setSequence(boolean on);
+/* Next message sent is the retransmission of the last one: it keeps its
+*  sequence number (flag cleared by sending) */
+  void setRetry(boolean on);
+/* Sequence number of last message received or sent */  
+  unsigned int getSeq();
+/* Acknowledge discarded duplicates for this node (not control messages), 
+*  because their sender has lost the first acknowledge (def.: off) */  
+  void setDupAck(boolean on);
+/* Number of duplicates discarded */  
+  unsigned long getDuplicates();
+  
+/**** Statistics ****/
+/* Counters are updated on every send and receive path (without locks: a 
+*  receiving interrupt routine can update them); LoraNode adds MAC counters */
+/* Live counters (to increment application or MAC counters) */  
+  LoraStats* getStats();
+/* Consistent copy (copied again if updated during copy) */  
+  void snapshotStats(LoraStats* s);
+  void resetStats();
+/* Binary export: ['L'][statVersion][n fields][n x 4 bytes little endian].
+   Return bytes written (0 if len too small) */
+  int exportStats(byte* buff,int len);
 
 /* Check if any message is on air (channel busy). If true, transmission can be done*/
   bool freeAir();
@@ -128,7 +264,8 @@ class LORA
 *  message is accepted because is a brodcast message).
 *  If function sender parameter (sendLocalAdd) is not 0, a check is done to verify 
 *  if message is incoming from expected sender; if not, it returns -1
-*  (or -2 if sender network address part is incorrect)
+*  (or -2 if sender network address part is incorrect, -3 if message is a 
+*  duplicate, -4 if compressed message is corrupted)
 *  Finally, return the length of the sole message (without addresses).
 *  The message pointer can be obtained by getMess() function.
 *  The sender address can be obtained by getSender() function. 
@@ -145,6 +282,43 @@ class LORA
   
 /* Get the random marker included on message (both in sent message or in received message)*/  
   byte getMarker();
+/* Marker and sequence number of last message (sent or received) that bind
+   its acknowledge */  
+  unsigned long getAckTag();
+
+/* Get destination sub-address of last message received (0 if broadcast) */
+  unsigned int getDest();
+
+/* Keep a copy of last message received (while waiting for another one). Only
+*  one message is kept: it returns false if another one is already kept */
+  boolean holdMess();
+/* Kept message (from fromSubAdd, 0: any) becomes again the last message 
+*  received (getMessage(), getSender() ...). It returns its length or 0 if 
+*  there is none */
+  int takeHeldMess(unsigned int fromSubAdd);
+  
+/******** Implicit header frames and acknowledges **************/
+
+/* Send/receive a frame len bytes long in implicit header mode (no PHY header)
+*  with spreading factor sf (0: same of messages; 6 is the fastest). 
+*  Receiver must use the same len and sf. Configuration of messages is 
+*  restored at the end. receiveImplicit waits max tout ms and returns len 
+*  (0 if nothing received, <0 if CRC error) */
+  int sendImplicit(byte mess[],byte len,byte sf);
+  int receiveImplicit(byte buff[],byte len,byte sf,int tout);
+
+/* Acknowledges are implicit header frames (6 bytes, not crypted) with a check
+*  made with the key on addresses, marker and sequence number of the 
+*  acknowledged message. Set their spreading factor (def. 0: 
+*  same of messages). All nodes must use the same value */
+  void setAckSprFactor(byte sf);
+/* Acknowledge last message received (to its sender) (high priority) */  
+  int sendAck(unsigned int toSubAdd, unsigned int fromSubAdd);
+/* Wait tout ms for the acknowledge of last message sent */  
+  bool waitAck(unsigned int toSubAdd, unsigned int fromSubAdd,int tout);
+/* Same, for a message with tag (getAckTag()) (not the last one) */
+  int sendAck(unsigned int toSubAdd, unsigned int fromSubAdd, unsigned long tag);
+  bool waitAck(unsigned int toSubAdd, unsigned int fromSubAdd, unsigned long tag, int tout);
   
 
 /******** Utilities **************/
@@ -162,6 +336,8 @@ class LORA
 *  The parameter freq is in MHz Ex.: 433.93 (default 434.0)
 */ 
   void setFrequency(float freq);
+/* Equivalent to SX.setFreqHz (exact frequency in Hz Ex.: 433920000) */
+  void setFrequencyHz(unsigned long hz);
 
 /* For convenience. Like SX.setState(state).
 *  If yes==true radio module goes in lowest power state.
@@ -190,6 +366,7 @@ class LORA
 *  Destination word (two bytes) is not encoded.
 */
   int sendMess(unsigned int destAdd, unsigned int sendAdd, byte *mess, int lmess); 
+  int sendMess(unsigned int destAdd, unsigned int sendAdd, byte *mess, int lmess, byte flags); 
 
 /* Receive incoming message into the buffer buff
 *  If no message is incoming, return 0.
@@ -229,7 +406,8 @@ class LORA
 /*** Send ***/
 
 /* Send message (packet) mlen long (or null terminated string).
-   Return 0 if ok (sent) or -1 if problem (not sent) */  
+   Return 0 if ok (sent) or -1 if problem (not sent) 
+   or -2 if duty cycle budget is exhausted (not sent) */  
   int sendMess(char mess[]);
   int sendMess(byte mess[],byte mlen);
 
@@ -260,14 +438,38 @@ class LORA
 
   int getReceivedMessLen(){return receivedMessLen;}
 
-  void decodeMess(byte *buff,int len);  
+/* Decrypt (and inflate) frame buff len bytes long. It returns message length
+   or -1 if frame can't be decoded */
+  int decodeMess(byte *buff,int len);  
   
   private:
   unsigned int senderAddress;
   byte *receivedMessage;
   int receivedMessLen;
   unsigned int subNetSenderAddress;
+  unsigned int subNetDestAddress;
   byte marker;
+  boolean zip;
+  byte unzBuff[lzMaxLen+1];      //inflated message
+  LoraDuty* duty;
+  LoraHop* hop;
+  LoraAfc* afc;
+  LoraPeers* peers;
+  boolean seqOn;
+  boolean retry;
+  boolean dupAck;
+  uint16_t txSeq;                 //16 bits as on air (int is 32 bits on ESP32)
+  uint16_t seq;
+  LoraStats st;
+  LoraHeld held;
+  unsigned long airUs;            //airtime not yet counted in ms
+  boolean seqCheck(LoraPeer* p);
+  byte ackSF;
+  unsigned int ackCheck(unsigned int destAdd,unsigned int sendAdd,unsigned long tag);
+  unsigned int afcPeer;           //peer of next transmission/reception
+  void tune();
+  void pause(unsigned long ms);
+  boolean prio;
   
   unsigned int netAddress;
   byte r2p;
@@ -0,0 +1,95 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraAfc.h"
+
+LoraAfc::LoraAfc():own(maxAfcPeers)
+{
+  peers=&own;
+  drift=0;
+  tvalid=false;
+  temp=0;
+}
+
+void LoraAfc::usePeers(LoraPeers* tb)
+{
+  if (tb==NULL) tb=&own;
+  peers=tb;
+}
+
+void LoraAfc::reset()
+{
+  for (unsigned int i=0;i<peers->size();i++) 
+    {LoraPeer* p=peers->slot(i);if (p!=NULL) p->fn=0;}
+  drift=0;
+}
+
+long LoraAfc::project(LoraPeer* p){return p->ferr+drift*(temp-p->ftemp);}
+
+/* Measures are done while receiving: temperature is not read here */
+void LoraAfc::update(unsigned int peer,long ferr)
+{
+  if ((peer==0)||(ferr>afcMaxErr)||(ferr<-afcMaxErr)) return;
+  LoraPeer* p=peers->add(peer);
+  if (p==NULL) return;
+  if (p->fn==0) {p->ferr=ferr;p->ftemp=temp;p->fn=1;return;}
+  int dt=temp-p->ftemp;
+  if ((dt>=afcTempStep)||(dt<=-afcTempStep)) drift+=((ferr-p->ferr)/dt-drift)/afcAvgDiv;
+  long pred=project(p);
+  p->ferr=pred+(ferr-pred)/afcAvgDiv;
+  p->ftemp=temp;
+  if (p->fn<255) p->fn++;
+}
+
+/* Temperature is not read here (send/receive path): see sampleTemp() */
+long LoraAfc::getOffset(unsigned int peer)
+{
+  if (peer!=0)
+  {
+    LoraPeer* p=peers->get(peer);
+    if ((p!=NULL)&&(p->fn>0)) return project(p);
+  }
+  long sum=0;int n=0;
+  for (unsigned int i=0;i<peers->size();i++) 
+  {
+    LoraPeer* p=peers->slot(i);
+    if ((p!=NULL)&&(p->fn>0)) {sum+=project(p);n++;}
+  }
+  if (n==0) return 0;
+  return sum/n;
+}
+
+int LoraAfc::getCount(unsigned int peer)
+{
+  LoraPeer* p=peers->get(peer);
+  if (p==NULL) return 0;
+  return p->fn;
+}
+
+long LoraAfc::getDrift(){return drift;}
+void LoraAfc::setDrift(long hzPerDeg){drift=hzPerDeg;}
+
+int LoraAfc::getTemp(){return temp;}
+
+bool LoraAfc::tempDue(){return !tvalid||(millis()-ttemp>=afcTempMs);}
+
+void LoraAfc::sampleTemp()
+{
+  if (!tempDue()) return;
+  int t=SX.readTempLora();
+  if (!tvalid) 
+    for (unsigned int i=0;i<peers->size();i++) 
+      {LoraPeer* p=peers->slot(i);if (p!=NULL) p->ftemp=t;}
+  temp=t;
+  ttemp=millis();
+  tvalid=true;
+}
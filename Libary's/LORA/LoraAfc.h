@@ -0,0 +1,85 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraAfc.
+*  Automatic frequency correction. For every packet received the frequency 
+*  error estimated by the radio (RegFei) is averaged per peer: it is the 
+*  offset between the peer oscillator and the local one.
+*  Before sending to a peer, local frequency is corrected by the peer offset
+*  (SX.setFreqCorr); before receiving, by the offset of the expected sender 
+*  or by the mean offset of all peers.
+*  Crystals drift with temperature: board temperature (SX.readTempLora, every 
+*  minute, read by LR.update() outside send/receive: it needs SLEEP and FSK 
+*  mode for a while) is stored with every offset and the drift (Hz per degree) is learned
+*  when the same peer is measured at different temperatures. Offsets are 
+*  projected to the current temperature.
+*  Offsets are kept in the peer table (LoraPeers) of LORA if any, otherwise
+*  in an internal table of 8 peers.
+*  Use: LoraAfc Afc; LR.setAfc(&Afc); LR.update() in the loop.
+*/
+
+#ifndef LoraAfc_h
+#define LoraAfc_h
+
+#include <SX1278.h>
+#include <LoraPeers.h>
+
+#define maxAfcPeers   8          //internal peers table length
+#define afcAvgDiv     4          //averaging weight of new measures (1/4)
+#define afcTempMs     60000UL    //temperature sampling period (ms)
+#define afcTempStep   2          //min temperature change to learn drift (degrees)
+#define afcMaxErr     50000L     //measures over this (Hz) are discarded
+
+class LoraAfc
+{
+  public:
+  
+  LoraAfc();
+  
+/* Add frequency offset ferr (Hz, from nominal frequency) measured on a 
+   packet of peer (local address) */
+  void update(unsigned int peer,long ferr);
+/* Correction (Hz) for peer at current temperature (peer=0 or unknown: mean of 
+   all peers; 0 if none) */
+  long getOffset(unsigned int peer);
+/* Number of measures of peer (0 if unknown) */
+  int getCount(unsigned int peer);
+  
+/* Learned drift (Hz per degree); it can be preset if known */  
+  long getDrift();
+  void setDrift(long hzPerDeg);
+/* Last board temperature read (radio sensor, not calibrated) */  
+  int getTemp();
+/* True if sampling period is expired (or temperature never read) */  
+  bool tempDue();
+/* Read temperature if sampling period is expired (radio must be in standby
+   and it is left in standby) */  
+  void sampleTemp();
+  
+/* Clear offsets and drift */  
+  void reset();
+/* Keep offsets in peer table tb (NULL: internal table) */  
+  void usePeers(LoraPeers* tb);
+
+  private:
+  long project(LoraPeer* p);
+  
+  LoraPeers own;
+  LoraPeers* peers;
+  long drift;
+  int temp;
+  unsigned long ttemp;           //time of last temperature reading
+  bool tvalid;
+};
+
+#endif
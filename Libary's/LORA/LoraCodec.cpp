@@ -0,0 +1,247 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraCodec. Compact binary coding of sensor values.
+*  Message format: 
+*  - presence bits of optional fields (1 byte each 8 optional fields)
+*  - fields in schema order: varint for FldUInt, FldInt and FldFixed,
+*    consecutive FldBits packed in bytes (LSB first)
+*/
+
+#include "LoraCodec.h"
+
+static const long pow10tab[7]={1,10,100,1000,10000,100000,1000000};
+
+LoraCodec::LoraCodec(const CodecField* schema,byte nfields)
+{
+  sch=schema;
+  nf=nfields;
+  nopt=0;
+  for (int i=0;i<nf;i++) if (sch[i].type&FldOpt) nopt++;
+  buf=NULL;
+  err=true;
+}
+
+/**** Encoding ****/
+
+void LoraCodec::beginEncode(byte buff[],int maxlen)
+{
+  start(buff,maxlen,true);
+  if (!err) memset(buf,0,pos);
+}
+
+bool LoraCodec::putUInt(unsigned long v)
+{
+  if (!nextField(FldUInt)) return false;
+  return putVar(v);
+}
+
+bool LoraCodec::putInt(long v)
+{
+  if (!nextField(FldInt)) return false;
+  return putVar(zigzag(v));
+}
+
+bool LoraCodec::putFloat(float v)
+{
+  if (!nextField(FldFixed)) return false;
+  float f=v*pow10tab[sch[fi-1].arg];
+  long l=(f<0)?(long)(f-0.5):(long)(f+0.5);
+  return putVar(zigzag(l));
+}
+
+bool LoraCodec::putBits(unsigned long v)
+{
+  if (!nextField(FldBits)) return false;
+  byte n=sch[fi-1].arg;
+  acc|=(v&((1UL<<n)-1))<<nacc;
+  nacc+=n;
+  while (nacc>=8)
+  {
+    if (pos>=blen) {err=true;return false;}
+    buf[pos++]=acc&0xFF;acc>>=8;nacc-=8;
+  }
+  return true;
+}
+
+bool LoraCodec::skip()
+{
+  if (err||(fi>=nf)||!(sch[fi].type&FldOpt)) {err=true;return false;}
+  oi++;fi++;
+  return true;
+}
+
+int LoraCodec::endEncode()
+{
+  if (!enc) err=true;
+  flushBits();
+  if (err||(fi!=nf)) return -1;
+  return pos;
+}
+
+/**** Decoding ****/
+
+bool LoraCodec::beginDecode(byte buff[],int len)
+{
+  start(buff,len,false);
+  return !err;
+}
+
+bool LoraCodec::isPresent()
+{
+  if (err||(fi>=nf)) return false;
+  if (!(sch[fi].type&FldOpt)) return true;
+  return bitRead(buf[oi/8],oi%8);
+}
+
+unsigned long LoraCodec::getUInt()
+{
+  unsigned long v=0;
+  if (nextField(FldUInt)) getVar(&v);
+  return v;
+}
+
+long LoraCodec::getInt()
+{
+  unsigned long v=0;
+  if (nextField(FldInt)) getVar(&v);
+  return unzigzag(v);
+}
+
+float LoraCodec::getFloat()
+{
+  unsigned long v=0;
+  if (!nextField(FldFixed)) return 0;
+  getVar(&v);
+  return (float)unzigzag(v)/pow10tab[sch[fi-1].arg];
+}
+
+unsigned long LoraCodec::getBits()
+{
+  if (!nextField(FldBits)) return 0;
+  byte n=sch[fi-1].arg;
+  while (nacc<n)
+  {
+    if (pos>=blen) {err=true;return 0;}
+    acc|=(unsigned long)buf[pos++]<<nacc;nacc+=8;
+  }
+  unsigned long v=acc&((1UL<<n)-1);
+  acc>>=n;nacc-=n;
+  return v;
+}
+
+bool LoraCodec::endDecode()
+{
+  return (!err)&&(!enc)&&(fi==nf);
+}
+
+/**** Utilities ****/
+
+int LoraCodec::writeVarint(byte buff[],int maxlen,unsigned long v)
+{
+  int n=0;
+  do
+  {
+    if (n>=maxlen) return 0;
+    byte b=v&0x7F;v>>=7;
+    if (v) b|=0x80;
+    buff[n++]=b;
+  } while (v);
+  return n;
+}
+
+int LoraCodec::readVarint(byte buff[],int len,unsigned long* v)
+{
+  unsigned long r=0;
+  for (int n=0;(n<len)&&(n<5);n++)
+  {
+    if ((n==4)&&(buff[n]>0x0F)) return 0;      //more than 32 bits
+    r|=(unsigned long)(buff[n]&0x7F)<<(7*n);
+    if (!(buff[n]&0x80)) {*v=r;return n+1;}
+  }
+  return 0;
+}
+
+unsigned long LoraCodec::zigzag(long v)
+{
+  return ((unsigned long)v<<1)^(unsigned long)(v>>(sizeof(long)*8-1));
+}
+
+long LoraCodec::unzigzag(unsigned long v)
+{
+  return (long)(v>>1)^-(long)(v&1);
+}
+
+/**** Private ****/
+
+void LoraCodec::start(byte buff[],int len,bool encoding)
+{
+  buf=buff;
+  blen=len;
+  enc=encoding;
+  fi=0;oi=0;acc=0;nacc=0;
+  pos=(nopt+7)/8;
+  err=(pos>blen)||(nopt>maxCodecOpt);
+}
+
+/* Check type of next field and manage its presence bit. 
+   Pending bitfields are closed by any present field that is not a bitfield.
+   It returns false if field is absent or error */
+bool LoraCodec::nextField(byte type)
+{
+  if (err||(fi>=nf)) {err=true;return false;}
+  byte t=sch[fi].type;
+  byte a=sch[fi].arg;
+  if ((t&~FldOpt)!=type) {err=true;return false;}
+  if ((type==FldFixed)&&(a>6)) {err=true;return false;}
+  if ((type==FldBits)&&((a<1)||(a>24))) {err=true;return false;}
+  bool p=true;
+  if (t&FldOpt)
+  {
+    if (enc) bitSet(buf[oi/8],oi%8);
+    else p=bitRead(buf[oi/8],oi%8);
+    oi++;
+  }
+  fi++;
+  if (!p) return false;
+  if (type!=FldBits) flushBits();
+  return true;
+}
+
+bool LoraCodec::putVar(unsigned long v)
+{
+  int n=writeVarint(&buf[pos],blen-pos,v);
+  if (n==0) {err=true;return false;}
+  pos+=n;
+  return true;
+}
+
+bool LoraCodec::getVar(unsigned long* v)
+{
+  int n=readVarint(&buf[pos],blen-pos,v);
+  if (n==0) {err=true;*v=0;return false;}
+  pos+=n;
+  return true;
+}
+
+/* Encoding: write last partial byte of bitfields. Decoding: discard it */
+void LoraCodec::flushBits()
+{
+  if (nacc==0) return;
+  if (enc)
+  {
+    if (pos>=blen) {err=true;return;}
+    buf[pos++]=acc&0xFF;
+  }
+  acc=0;nacc=0;
+}
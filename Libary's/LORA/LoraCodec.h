@@ -0,0 +1,121 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraCodec.
+*  Compact binary coding of sensor values for LoraNode messages (instead of 
+*  text made by itoa and read by atoi).
+*  Message structure is described by a schema: an array of fields, each with 
+*  a type and an argument:
+*  - FldUInt  : unsigned integer (varint: 7 bits per byte)
+*  - FldInt   : signed integer (zigzag varint: small negative values are short)
+*  - FldFixed : float coded as integer value*10^arg (arg = decimals, 0 to 6)
+*  - FldBits  : unsigned integer arg bits long (1 to 24), packed with the
+*               bitfields that follow
+*  Type can be or-ed with FldOpt: field can be absent and just a presence bit
+*  is coded (at the beginning of message).
+*  Values are coded (or decoded) in schema order, directly into (from) the
+*  message buffer. No memory is allocated.
+*  Ex.:
+*  const CodecField sch[]={{FldFixed,1},{FldUInt,0},{FldBits,1},{FldInt|FldOpt,0}};
+*  LoraCodec Cd(sch,4);
+*  Cd.beginEncode(buff,32);Cd.putFloat(21.5);Cd.putUInt(1013);Cd.putBits(1);Cd.skip();
+*  int len=Cd.endEncode();
+*/
+
+#ifndef LoraCodec_h
+#define LoraCodec_h
+
+#include <Arduino.h>
+
+/* Field types */
+#define FldUInt  0
+#define FldInt   1
+#define FldFixed 2
+#define FldBits  3
+#define FldOpt   0x80   //optional field flag
+
+#define maxCodecOpt 32  //max optional fields in a schema
+
+struct CodecField
+{
+  byte type;            //field type (or-ed with FldOpt if optional)
+  byte arg;             //decimals for FldFixed, bits for FldBits
+};
+
+class LoraCodec
+{
+  public:
+  
+/* Codec for messages described by schema of nfields fields */  
+  LoraCodec(const CodecField* schema,byte nfields);
+
+/**** Encoding ****/
+  
+/* Start coding a message into buff (max maxlen bytes) */  
+  void beginEncode(byte buff[],int maxlen);
+/* Code next field. They return false if field type is wrong or buffer is full */  
+  bool putUInt(unsigned long v);
+  bool putInt(long v);
+  bool putFloat(float v);
+  bool putBits(unsigned long v);
+/* Next (optional) field is absent */  
+  bool skip();
+/* End of message. It returns message length or -1 if error */  
+  int endEncode();
+
+/**** Decoding ****/
+
+/* Start decoding message buff len bytes long */
+  bool beginDecode(byte buff[],int len);
+/* True if next field is present (always true if not optional) */  
+  bool isPresent();
+/* Decode next field (0 if absent or error) */  
+  unsigned long getUInt();
+  long getInt();
+  float getFloat();
+  unsigned long getBits();
+/* End of decoding. It returns false if any error occurred */  
+  bool endDecode();
+  
+/**** Utilities ****/
+
+/* Raw varint and zigzag coding of 32 bits values. They return bytes used 
+   (0 if no space, or varint truncated or longer than 32 bits) */  
+  static int writeVarint(byte buff[],int maxlen,unsigned long v);
+  static int readVarint(byte buff[],int len,unsigned long* v);
+  static unsigned long zigzag(long v);
+  static long unzigzag(unsigned long v);
+  
+  private:
+  void start(byte buff[],int len,bool encoding);
+  bool nextField(byte type);
+  bool putVar(unsigned long v);
+  bool getVar(unsigned long* v);
+  void flushBits();
+  
+  const CodecField* sch;
+  byte nf;
+  byte nopt;            //number of optional fields
+  
+  byte* buf;
+  int blen;
+  int pos;
+  byte fi;              //current field
+  byte oi;              //current optional field
+  unsigned long acc;    //bits accumulator
+  byte nacc;            //bits in accumulator
+  bool enc;             //encoding or decoding
+  bool err;
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraDuty.h"
+
+LoraDuty::LoraDuty()
+{
+  for (int i=0;i<maxSubBands;i++) setBand(i,0,0,0);
+  setBand(0,433050000UL,434790000UL,100);
+  setBand(1,863000000UL,868000000UL,10);
+  setBand(2,868000000UL,868600000UL,10);
+  setBand(3,868700000UL,869200000UL,1);
+  setBand(4,869400000UL,869650000UL,100);
+  setBand(5,869700000UL,870000000UL,10);
+  memset(air,0,sizeof(air));
+  cur=0;
+  tcur=millis();
+  reserve=defDutyRes;
+}
+
+void LoraDuty::setBand(byte i,unsigned long fmin,unsigned long fmax,unsigned int limit)
+{
+  if (i>=maxSubBands) return;
+  bands[i].fmin=fmin;bands[i].fmax=fmax;bands[i].limit=limit;
+}
+
+int LoraDuty::getBand(unsigned long hz)
+{
+  for (int i=0;i<maxSubBands;i++)
+   if ((bands[i].limit>0)&&(hz>=bands[i].fmin)&&(hz<bands[i].fmax)) return i;
+  return -1;
+}
+
+void LoraDuty::setReserve(unsigned int permille){if (permille>1000) permille=1000;reserve=permille;}
+
+void LoraDuty::charge(unsigned long hz,unsigned long us)
+{
+  int b=getBand(hz);
+  if (b<0) return;
+  update();
+  air[b][cur]+=us;
+}
+
+unsigned long LoraDuty::remaining(unsigned long hz,bool prio)
+{
+  int b=getBand(hz);
+  if (b<0) return 0xFFFFFFFFUL;
+  unsigned long bg=budget(b,prio);
+  unsigned long u=used(b);
+  if (u>=bg) return 0;
+  return bg-u;
+}
+
+/* Oldest buckets leave the window one by one: find the first time enough
+   airtime is released */
+unsigned long LoraDuty::waitTime(unsigned long hz,unsigned long us,bool prio)
+{
+  int b=getBand(hz);
+  if (b<0) return 0;
+  unsigned long bg=budget(b,prio);
+  unsigned long u=used(b);
+  if (u+us<=bg) return 0;
+  if (us>bg) return 0xFFFFFFFFUL;
+  unsigned long tnext=dutyBucketMs-(millis()-tcur);
+  for (int k=1;k<dutyBuckets;k++)
+  {
+    u-=air[b][(cur+k)%dutyBuckets];
+    if (u+us<=bg) return tnext+(k-1)*dutyBucketMs;
+  }
+  return tnext+(dutyBuckets-1)*dutyBucketMs;
+}
+
+unsigned long LoraDuty::used(byte band)
+{
+  if (band>=maxSubBands) return 0;
+  update();
+  unsigned long u=0;
+  for (int k=0;k<dutyBuckets;k++) u+=air[band][k];
+  return u;
+}
+
+/* Private */
+
+/* Move current bucket, clearing buckets leaving the window */
+void LoraDuty::update()
+{
+  unsigned long now=millis();
+  if (now-tcur>=dutyBuckets*dutyBucketMs) 
+  {
+    memset(air,0,sizeof(air));
+    tcur=now;
+    return;
+  }
+  while (now-tcur>=dutyBucketMs)
+  {
+    cur=(cur+1)%dutyBuckets;
+    for (int i=0;i<maxSubBands;i++) air[i][cur]=0;
+    tcur+=dutyBucketMs;
+  }
+}
+
+/* Airtime (us) allowed in the window */
+unsigned long LoraDuty::budget(byte band,bool prio)
+{
+  unsigned long bg=bands[band].limit*(dutyBuckets*dutyBucketMs);  //us
+  if (!prio) bg=bg/1000*(1000-reserve);
+  return bg;
+}
@@ -0,0 +1,86 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraDuty.
+*  Airtime accountant for duty cycle limits of sub-bands (ETSI EN 300 220).
+*  Time on air of every transmission is charged to the sub-band of the 
+*  frequency used, on a sliding window of one hour (60 buckets of 1 minute).
+*  Default sub-bands (EU):
+*    433.05-434.79 MHz 10%, 863.0-868.0 1%, 868.0-868.6 1%, 868.7-869.2 0.1%,
+*    869.4-869.65 10%, 869.7-870.0 1%
+*  Frequencies out of any sub-band are not limited.
+*  A part of budget (def. 10%) is reserved for high priority transmissions
+*  (acknowledges), so data traffic can't starve them.
+*  Use: LoraDuty DC; LR.setDutyCycle(&DC);
+*  Then LORA::sendMess returns -2 without transmitting (and without waiting)
+*  if budget is not enough: LoraNode keeps such messages in its queue and 
+*  sends them when budget is available again. Only completed transmissions 
+*  are charged.
+*/
+
+#ifndef LoraDuty_h
+#define LoraDuty_h
+
+#include <Arduino.h>
+
+#define maxSubBands   8          //sub-bands table length
+#define dutyBuckets   60         //buckets of sliding window
+#define dutyBucketMs  60000UL    //bucket length (ms) (window 1 hour)
+#define defDutyRes    100        //default budget reserved to high priority (per mille)
+
+struct DutyBand
+{
+  unsigned long fmin;            //Hz
+  unsigned long fmax;            //Hz
+  unsigned int  limit;           //duty cycle limit (per mille)
+};
+
+class LoraDuty
+{
+  public:
+  
+/* Accountant with EU default sub-bands */  
+  LoraDuty();
+  
+/* Set/clear (limit=0) sub-band i (0 to 7): frequency range (Hz) and duty 
+   cycle limit per mille (ex.: 10 = 1%) */  
+  void setBand(byte i,unsigned long fmin,unsigned long fmax,unsigned int limit);
+/* Sub-band of frequency hz (-1 if not limited) */  
+  int getBand(unsigned long hz);
+
+/* Budget part reserved to high priority transmissions (per mille, def. 100) */  
+  void setReserve(unsigned int permille);
+  
+/* Charge us microseconds of transmission on frequency hz */  
+  void charge(unsigned long hz,unsigned long us);
+/* Airtime (us) still available on frequency hz in the window 
+   (for normal or high priority transmissions) */  
+  unsigned long remaining(unsigned long hz,bool prio);
+/* Time (ms) to wait before a transmission us long can be done on frequency hz
+   (0: now) */  
+  unsigned long waitTime(unsigned long hz,unsigned long us,bool prio);
+/* Airtime (us) used on sub-band in the window */  
+  unsigned long used(byte band);
+
+  private:
+  void update();
+  unsigned long budget(byte band,bool prio);
+  
+  DutyBand bands[maxSubBands];
+  unsigned long air[maxSubBands][dutyBuckets];   //airtime (us) per bucket
+  byte cur;                                      //current bucket
+  unsigned long tcur;                            //current bucket start (ms)
+  unsigned int reserve;
+};
+
+#endif
@@ -0,0 +1,235 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraFsk.h"
+
+LoraFsk* LoraFsk::current=NULL;
+
+static const byte syncWord[fskSync]={0x4C,0x46,0x53,0x4B};
+
+LoraFsk::LoraFsk()
+{
+  state=FskIdle;pos=0;total=0;done=false;ready=false;
+  node=1;bps=4800;irq=false;pending=false;pin0=0;pin1=0;
+  from=0;to=0;rssi=0;
+  memset(&st,0,sizeof(st));
+}
+
+/* Modulation index 1 (deviation bps/2) while deviation + bps/2 <= 250 kHz;
+   AFC bandwidth has 20 kHz more for crystal offsets */
+bool LoraFsk::begin(unsigned long hz,unsigned long b,byte nodeAdd)
+{
+  if ((b<1200)||(b>300000)||(nodeAdd==0)||(nodeAdd==FskBroadcast)) return false;
+  end();
+  bps=b;node=nodeAdd;
+  SX.setState(SLEEP);
+  SX.startModeFSKOOK();
+  SX.setModulation(0);
+  SX.setState(STDBY);
+  SX.setFreqHz(hz);
+  SX.setBPS(bps);
+  unsigned long fd=bps/2;
+  if (fd+bps/2>250000) fd=250000-bps/2;
+  if (fd<600) fd=600;
+  SX.setFdev(fd);
+  SX.setRxBw(fd+bps/2,fd+bps/2+20000);
+  SX.SPIwrite(0x0A,0x29);        //gaussian filter BT 1.0, ramp 40 us
+  SX.SPIwrite(0x0D,0x1E);        //AFC and AGC auto, RX start on preamble
+  SX.setPreamble(fskPreamble,0);
+  SX.SPIwrite(0x1F,0xAA);        //preamble detector: 2 bytes, 10 chips tolerance
+  byte sc[1+fskSync]={0x50|(fskSync-1)}; //RX auto restart, sync on
+  memcpy(sc+1,syncWord,fskSync);
+  SX.SPIwriteBurst(0x27,sc,1+fskSync);
+  byte pk[6]={0xDC,              //variable length, whitening, CRC (kept if bad),
+                                 //address filter node or broadcast
+              0x40,              //packet mode
+              0xFF,              //max length
+              node,FskBroadcast,
+              0x80|(fskThr-1)};  //TX starts when FIFO not empty, threshold
+  SX.SPIwriteBurst(0x30,pk,6);
+  SX.setIOpin(0,0);              //DIO0 -> PacketSent / PayloadReady
+  SX.setIOpin(1,0);              //DIO1 -> FifoLevel
+  memset(&st,0,sizeof(st));
+  ready=false;
+  return true;
+}
+
+void LoraFsk::setPins(byte dio0,byte dio1)
+{
+  if (irq) {detachInterrupt(digitalPinToInterrupt(pin0));detachInterrupt(digitalPinToInterrupt(pin1));}
+  pin0=dio0;pin1=dio1;
+  current=this;
+  irq=true;
+  pending=true;
+  pinMode(pin0,INPUT);
+  pinMode(pin1,INPUT);
+  attachInterrupt(digitalPinToInterrupt(pin0),fskIsr,RISING);
+  attachInterrupt(digitalPinToInterrupt(pin1),fskIsr,CHANGE);
+}
+
+void LoraFsk::end()
+{
+  state=FskIdle;
+  if (irq)
+  {
+    detachInterrupt(digitalPinToInterrupt(pin0));
+    detachInterrupt(digitalPinToInterrupt(pin1));
+    irq=false;
+    current=NULL;
+  }
+  if (SX.readMode()==fskookmode) SX.setState(STDBY);
+}
+
+/* Whole packet in FIFO if it fits, the rest while sending */
+bool LoraFsk::send(byte dest,byte data[],byte len)
+{
+  if (len>fskMaxData) return false;
+  bool wasRx=(state==FskRx);
+  state=FskIdle;
+  SX.setState(STDBY);
+  SX.SPIwrite(0x3F,0x10);        //FIFO cleared
+  buf[0]=len+2;buf[1]=dest;buf[2]=node;
+  memcpy(buf+3,data,len);
+  total=len+3;pos=0;done=false;
+  fill(fskFifoLen);
+  state=FskTx;
+  pending=true;
+  SX.setState(TX);
+  unsigned long tout=timeOnAir(len)/1000+10;
+  unsigned long t=millis();
+  while (!done) {poll();if (millis()-t>tout) break;}
+  state=FskIdle;
+  SX.setState(STDBY);
+  if (done) st.txPackets++; else st.txFail++;
+  if (wasRx) startRx();
+  return done;
+}
+
+int LoraFsk::receive(byte buff[],int blen,unsigned long timeout)
+{
+  if (state!=FskRx) startRx();
+  unsigned long t=millis();
+  do {poll();if (ready) break;} while (millis()-t<timeout);
+  if (!ready) return 0;
+  int n=(rxLen<blen)?rxLen:blen;
+  memcpy(buff,rxb,n);
+  from=rxSender;to=rxDest;rssi=rxRssi;
+  ready=false;
+  return n;
+}
+
+byte LoraFsk::getSender(){return from;}
+byte LoraFsk::getDest(){return to;}
+int LoraFsk::getRssi(){return -(int)(rssi/2);}
+FskStats* LoraFsk::getStats(){return &st;}
+
+/* Preamble, sync word, length, addresses, data, CRC */
+unsigned long LoraFsk::timeOnAir(byte len)
+{
+  unsigned long bits=(fskPreamble+fskSync+3UL+len+2)*8;
+  return bits*1000000UL/bps;
+}
+
+void LoraFsk::startRx()
+{
+  state=FskIdle;
+  SX.setState(STDBY);
+  SX.SPIwrite(0x3F,0x10);        //FIFO cleared
+  pos=0;total=0;
+  state=FskRx;
+  pending=true;
+  SX.setState(FSRX);
+  SX.setState(RX);
+}
+
+/* TX: FifoLevel low means at least 33 free bytes (refill a chunk), 
+   RX: FifoLevel high means at least 32 bytes (length byte first, then a 
+   chunk without the last byte of packet: an empty FIFO clears PayloadReady); 
+   PayloadReady: the rest of packet (CRC bytes are not in FIFO).
+   It returns true if FIFO was served */
+bool LoraFsk::service()
+{
+  if (state==FskIdle) return false;
+  byte f=SX.SPIread(0x3F);
+  if (state==FskTx)
+  {
+    if (f&0x08) {done=true;return true;}
+    if (!(f&0x20)) {fill(fskFifoLen-fskThr);return true;}
+    return false;
+  }
+  if (f&0x10) {SX.SPIwrite(0x3F,0x10);pos=0;total=0;st.rxOverrun++;return true;}
+  if (f&0x04)
+  {
+    if (total==0) drain(1);
+    drain(total-pos);
+    complete(f&0x02);
+    return true;
+  }
+  if (f&0x20)
+  {
+    if (total==0) drain(1);
+    drain(min(fskThr,total-pos-1));
+    return true;
+  }
+  return false;
+}
+
+/* Without pins FIFO flags are read every time; with pins only after an 
+   interrupt, until there is nothing more to move */
+void LoraFsk::poll()
+{
+  if (irq&&!pending) return;
+  pending=false;
+  if (service()) pending=true;
+}
+
+void LoraFsk::fill(int n)
+{
+  if (n>total-pos) n=total-pos;
+  if (n<=0) return;
+  SX.SPIwriteBurst(RegFifo,buf+pos,n);
+  pos+=n;
+}
+
+void LoraFsk::drain(int n)
+{
+  if (n>(int)sizeof(buf)-pos) n=sizeof(buf)-pos;
+  if (n<=0) return;
+  if (pos==0) rxRssi=SX.SPIread(0x11);
+  SX.SPIreadBurst(RegFifo,buf+pos,n);
+  if (pos==0) total=buf[0]+1;
+  pos+=n;
+}
+
+/* Packet to rxb (an unread packet is replaced) */
+void LoraFsk::complete(bool crcOk)
+{
+  if (!crcOk||(total<3)||(pos<total)) st.rxCrcErr++;
+  else
+  {
+    if (ready) st.rxLost++;
+    rxLen=total-3;
+    memcpy(rxb,buf+3,rxLen);
+    rxDest=buf[1];rxSender=buf[2];
+    ready=true;
+    st.rxPackets++;
+  }
+  pos=0;total=0;
+}
+
+/* Interrupt routine: no SPI here (not IRAM code and a transfer of main 
+   program could be in progress), FIFO is served by poll() */
+void IRAM_ATTR LoraFsk::fskIsr()
+{
+  LoraFsk* e=current;
+  if (e!=NULL) e->pending=true;
+}
@@ -0,0 +1,126 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraFsk.
+*  FSK packet engine for a fast short range link between nodes (1200 to 
+*  300000 bps): packets up to 253 data bytes, larger than the 64 bytes FIFO,
+*  streamed into and out of the FIFO while the packet is on air, refilled 
+*  and drained in chunks of 32 bytes at the FIFO threshold (FifoLevel).
+*  Hardware does the rest: variable length format, CRC-16 (CCITT), data 
+*  whitening, address filtering (node or broadcast), preamble detection, 
+*  automatic restart of receiver after a packet.
+*  Packet: length, destination, sender, data.
+*  FIFO is served by send() and receive() (or service()) polling flags; with
+*  setPins() (DIO0 PacketSent/PayloadReady, DIO1 FifoLevel) flags are read 
+*  only after an interrupt. To receive while sketch does other things call 
+*  receive(buff,len,0) often (FIFO of 64 bytes: 1.7 ms at 300000 bps).
+*  Radio is switched to FSK mode by begin(): use SX.getContext()/setContext()
+*  to come back to LoRa mode (LORA) quickly.
+*  Use: LoraFsk Fsk; Fsk.begin(434000000,100000,2); 
+*       Fsk.send(1,buff,len);  n=Fsk.receive(buff,sizeof(buff),1000);
+*/
+
+#ifndef LoraFsk_h
+#define LoraFsk_h
+
+#include <SX1278.h>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#define fskMaxData     253       //data bytes in a packet
+#define fskFifoLen     64        //radio FIFO
+#define fskThr         32        //FIFO threshold (chunk moved by refill/drain)
+#define fskPreamble    5         //preamble bytes
+#define fskSync        4         //sync word bytes
+#define FskBroadcast   0xFF      //destination of broadcast packets
+
+/* Engine state */
+#define FskIdle        0
+#define FskTx          1
+#define FskRx          2
+
+struct FskStats
+{
+  unsigned long txPackets;
+  unsigned long txFail;          //PacketSent not seen (timeout)
+  unsigned long rxPackets;
+  unsigned long rxCrcErr;
+  unsigned long rxOverrun;       //FIFO overrun (packet lost)
+  unsigned long rxLost;          //packet not read before next one
+};
+
+class LoraFsk
+{
+  public:
+  
+  LoraFsk();
+  
+/* Switch radio to FSK packet mode: frequency (Hz), bit rate (bps), node 
+   address (1-254). Frequency deviation and bandwidth follow the bit rate.
+   It returns false if parameters are not valid */  
+  bool begin(unsigned long hz,unsigned long bps,byte node);
+/* Poll FIFO only after interrupt of pins connected to DIO0 and DIO1 */  
+  void setPins(byte dio0,byte dio1);
+/* Back to standby (receiver off) and interrupts detached */  
+  void end();
+  
+/* Send len bytes (max 253) to dest (FskBroadcast: all). It returns false if
+   packet is not sent */  
+  bool send(byte dest,byte data[],byte len);
+/* Wait up to timeout ms (0: just check) for a packet: copy data in buff 
+   (blen max) and return data length; 0 if nothing arrived. Receiver stays 
+   on after return (use end() to stop it) */  
+  int receive(byte buff[],int blen,unsigned long timeout);
+  
+/* Sender and destination of last packet received, RSSI (dBm) */  
+  byte getSender();
+  byte getDest();
+  int getRssi();
+  
+  FskStats* getStats();
+/* Time on air (us) of a packet of len data bytes */  
+  unsigned long timeOnAir(byte len);
+  
+/* Serve FIFO (read flags and move a chunk). It returns true if FIFO was 
+   served */  
+  bool service();
+
+  private:
+  static void IRAM_ATTR fskIsr();
+  static LoraFsk* current;       //engine served by interrupt
+  
+  byte buf[3+fskMaxData];        //packet moved (length, dest, sender, data)
+  volatile int pos;              //bytes moved to/from FIFO
+  volatile int total;            //packet bytes (0: length not read yet)
+  volatile byte state;
+  volatile bool done;            //packet sent
+  volatile bool ready;           //packet received (rxb)
+  byte rxb[fskMaxData];          //last packet received
+  byte rxLen,rxSender,rxDest,rxRssi;
+  byte from,to,rssi;             //last packet read by receive()
+  byte node;
+  unsigned long bps;
+  byte pin0,pin1;
+  bool irq;
+  volatile bool pending;         //interrupt not served yet
+  FskStats st;
+  void poll();
+  void startRx();
+  void fill(int n);
+  void drain(int n);
+  void complete(bool crcOk);
+};
+
+#endif
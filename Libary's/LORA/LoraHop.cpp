@@ -0,0 +1,109 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraHop.h"
+
+LoraHop* LoraHop::current=NULL;
+
+LoraHop::LoraHop()
+{
+  period=defHopPeriod;
+  hops=0;
+  pending=0;
+  active=false;
+}
+
+/* Sequence: permutations of channels one after the other (Fisher-Yates with 
+   16 bits xorshift generator), without the same channel on consecutive hops */
+bool LoraHop::begin(unsigned long freqHz[],byte n,unsigned int seed,byte per,byte dio2)
+{
+  if ((n<2)||(n>maxHopChannels)||(per==0)) return false;
+  if (active) end();
+  uint16_t x=seed|1;
+  byte perm[maxHopChannels];
+  int k=0;
+  while (k<hopSeqLen)
+  {
+    for (int i=0;i<n;i++) perm[i]=i;
+    for (int i=n-1;i>0;i--)
+    {
+      x^=x<<7;x^=x>>9;x^=x<<8;
+      int j=x%(i+1);
+      byte t=perm[i];perm[i]=perm[j];perm[j]=t;
+    }
+    if ((k>0)&&(perm[0]==seq[k-1])) {byte t=perm[0];perm[0]=perm[n-1];perm[n-1]=t;}
+    for (int i=0;(i<n)&&(k<hopSeqLen);i++) seq[k++]=perm[i];
+  }
+  for (k=0;k<hopSeqLen;k++) seqTab[k]=SX.makeChannel(freqHz[seq[k]]);
+  period=per;
+  pin=dio2;
+  hops=0;
+  
+  SX.SPIwrite(RegHopPeriod,period);
+  SX.setIOpin(2,0);              //DIO2 -> FhssChangeChannel
+  current=this;
+  active=true;
+  pinMode(pin,INPUT);
+  attachInterrupt(digitalPinToInterrupt(pin),hopIsr,RISING);
+  restart();
+  return true;
+}
+
+void LoraHop::end()
+{
+  if (!active) return;
+  detachInterrupt(digitalPinToInterrupt(pin));
+  active=false;
+  current=NULL;
+  SX.SPIwrite(RegHopPeriod,0);
+  SX.setChannel(seqTab[0]);
+}
+
+void LoraHop::restart()
+{
+  if (!active) return;
+  pending=0;
+  SX.setChannel(seqTab[0]);
+  SX.clearLoraFlag(FhssChangeChannel);
+}
+
+byte LoraHop::getChannel(byte step){return seq[step%hopSeqLen];}
+
+unsigned long LoraHop::getHops(){return hops;}
+
+bool LoraHop::isActive(){return active;}
+
+/* FhssPresentChannel is the hop step just started: write its channel and 
+   clear IRQ */
+void LoraHop::service()
+{
+  if (!active||!pending) return;
+  pending=0;
+  byte k=SX.SPIread(RegHopChannel)&(hopSeqLen-1);
+  SX.setChannel(seqTab[k]);
+  SX.clearLoraFlag(FhssChangeChannel);
+  hops++;
+}
+
+void LoraHop::wait(unsigned long ms)
+{
+  unsigned long t=millis();
+  do {service();delay(1);} while (millis()-t<ms);
+}
+
+/* Interrupt routine: no SPI here (not IRAM code and a transfer of main 
+   program could be in progress) */
+void IRAM_ATTR LoraHop::hopIsr()
+{
+  LoraHop* h=current;
+  if (h!=NULL) h->pending=1;
+}
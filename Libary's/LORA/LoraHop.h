@@ -0,0 +1,83 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraHop.
+*  Frequency hopping (FHSS) using SX1278 hardware: the radio changes channel 
+*  every hop period (RegHopPeriod, in symbols) during transmission and 
+*  reception of a packet and signals it with FhssChangeChannel IRQ on DIO2.
+*  The interrupt routine only takes note of the IRQ (no SPI): the next 
+*  channel, taken from a table of Frf registers precomputed for the whole hop
+*  sequence (one SPI burst write), is written by service(), called by LORA 
+*  wait loops (sendMess, receive functions, dataRead) every ms. The hop period
+*  must be longer than the polling interval of dataRead() when it is used.
+*  Sender and receiver must use the same channels, seed and hop period.
+*  The hop sequence (64 hops) is a chain of pseudo random permutations of the
+*  channels, generated from the seed (same sequence on every platform).
+*  Every packet starts on the first channel of the sequence.
+*  Use: LoraHop Hop; Hop.begin(freqs,n,seed,period,dio2pin); LR.setHopping(&Hop);
+*/
+
+#ifndef LoraHop_h
+#define LoraHop_h
+
+#include <SX1278.h>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#define maxHopChannels 16        //Max channels of hop sequence
+#define hopSeqLen      64        //Hop sequence length (FhssPresentChannel range)
+#define defHopPeriod   20        //Default hop period (symbols)
+
+class LoraHop
+{
+  public:
+  
+  LoraHop();
+  
+/* Precompute hop sequence of n channels (frequencies in Hz, max 16) from seed, 
+   set hop period (symbols, 1-255) and attach FhssChangeChannel interrupt of 
+   pin dio2 (radio DIO2). It returns false if parameters are not valid */  
+  bool begin(unsigned long freqHz[],byte n,unsigned int seed,byte period,byte dio2);
+/* Stop hopping: detach interrupt and come back to first channel */  
+  void end();
+  
+/* Go to first channel of sequence (called by LORA before every packet) */  
+  void restart();
+  
+/* Write channel of present hop step if FhssChangeChannel IRQ happened */  
+  void service();
+/* Delay ms milliseconds serving channel changes */  
+  void wait(unsigned long ms);
+  
+/* Channel index used at hop step (0 to 63) */  
+  byte getChannel(byte step);
+/* Number of hops made */  
+  unsigned long getHops();
+  bool isActive();
+  
+  private:
+  static void IRAM_ATTR hopIsr();
+  static LoraHop* current;       //hopping instance serviced by interrupt
+  
+  SXChannel seqTab[hopSeqLen];   //Frf registers for every hop step
+  byte seq[hopSeqLen];           //channel index for every hop step
+  byte period;
+  byte pin;
+  volatile byte pending;         //FhssChangeChannel IRQ not served yet
+  unsigned long hops;
+  bool active;
+};
+
+#endif
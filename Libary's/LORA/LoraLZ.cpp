@@ -0,0 +1,80 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraLZ.h"
+
+int LoraLZ::compress(const byte in[],int inlen,byte out[],int maxout)
+{
+  if ((inlen>lzMaxLen)||(maxout<1)) return -1;
+  out[0]=inlen;
+  int o=1;
+  int fpos=0;                    //position of current flag byte
+  byte nitem=8;
+  int i=0;
+  while (i<inlen)
+  {
+    if (nitem==8) {if (o>=maxout) return -1;fpos=o++;out[fpos]=0;nitem=0;}
+    int best=0;int dist=0;
+    int ws=(i>256)?i-256:0;
+    for (int j=i-1;j>=ws;j--)    //longest match in window (nearest first)
+    {
+      int l=0;
+      while ((i+l<inlen)&&(l<258)&&(in[j+l]==in[i+l])) l++;
+      if (l>best) {best=l;dist=i-j;if (l==258) break;}
+    }
+    if (best>=lzMinMatch)
+    {
+      if (o+2>maxout) return -1;
+      out[o++]=dist-1;out[o++]=best-lzMinMatch;
+      i+=best;
+    }
+    else
+    {
+      if (o>=maxout) return -1;
+      bitSet(out[fpos],nitem);
+      out[o++]=in[i++];
+    }
+    nitem++;
+  }
+  return o;
+}
+
+int LoraLZ::decompress(const byte in[],int inlen,byte out[],int maxout)
+{
+  if (inlen<1) return -1;
+  int olen=in[0];
+  if (olen>maxout) return -1;
+  int o=0;
+  int i=1;
+  byte flags=0;
+  byte nitem=8;
+  while (o<olen)
+  {
+    if (nitem==8) {if (i>=inlen) return -1;flags=in[i++];nitem=0;}
+    if (bitRead(flags,nitem))
+    {
+      if (i>=inlen) return -1;
+      out[o++]=in[i++];
+    }
+    else
+    {
+      if (i+2>inlen) return -1;
+      int dist=in[i]+1;
+      int len=in[i+1]+lzMinMatch;
+      i+=2;
+      if ((dist>o)||(o+len>olen)) return -1;
+      for (int k=0;k<len;k++) {out[o]=out[o-dist];o++;}
+    }
+    nitem++;
+  }
+  return olen;
+}
@@ -0,0 +1,42 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraLZ.
+*  Small LZSS compressor for LoRa messages (max 255 bytes).
+*  Window is the message itself, so no memory is used but the output buffer.
+*  Format: original length byte, then groups of 8 items preceded by a flag 
+*  byte (bit=1 literal byte, bit=0 match). Match is 2 bytes: distance-1 and
+*  length-3 (length 3 to 258, distance 1 to 256).
+*  Used by LORA::sendMess when compression is set (see LORA::setCompression).
+*/
+
+#ifndef LoraLZ_h
+#define LoraLZ_h
+
+#include <Arduino.h>
+
+#define lzMinMatch 3             //shorter matches are coded as literals
+#define lzMaxLen   255           //max message length
+
+class LoraLZ
+{
+  public:
+/* Compress inlen bytes of in into out (max maxout bytes). It returns 
+   compressed length or -1 if compressed message doesn't fit maxout */  
+  static int compress(const byte in[],int inlen,byte out[],int maxout);
+/* Decompress in (inlen bytes, padding bytes can follow) into out (max maxout
+   bytes). It returns original length or -1 if error */  
+  static int decompress(const byte in[],int inlen,byte out[],int maxout);
+};
+
+#endif
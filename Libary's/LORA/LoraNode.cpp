@@ -1,5 +1,7 @@
 
 #include "LoraNode.h"
+#include "LoraTrace.h"
+#include "LoraWatch.h"
 #include <EEPROM.h>
 
 void LoraNode::initDefault()
@@ -25,6 +27,29 @@ void LoraNode::initDefault()
   LR.defNetAddress(NETADD); 
 
   autoAK=false; 
+  retries=0;
+  lastFail=0;
+
+  ctrlCode=0;
+  ctrlOff=0;
+  heldCode=0;
+  heldOff=0;
+  pollId=0;
+  pollCoord=0;
+  pollCount=0;
+  
+  batchDelay=0;
+  qlen=0;
+  deferred=false;
+  
+  reqId=0;
+  reqFrom=0;
+  for (int i=0;i<maxRpcPending;i++) rpcTab[i].state=RpcFree;
+  
+  nch=0;
+  curch=0;
+  swPend=false;
+  resetChannelStats();
 }
 
 LoraNode::LoraNode()
@@ -64,11 +89,21 @@ bool LoraNode::begin()
   if (!LR.begin(KEYVAL)) return false; 
   factive=true;
   LR.setFrequency(FREQ);  
+  if (nch>0) SX.setChannel(chTab[curch]);
   LR.setPower(PWR);
   LR.setConfig(SF,BW,CR); 
   return true; 
 }
 
+bool LoraNode::begin(unsigned int sig)
+{
+  if (!LR.beginWarm(sig,KEYVAL)) return begin();
+  factive=true;
+  return true;
+}
+
+unsigned int LoraNode::getSignature(){return LR.getSignature();}
+
 void LoraNode::setKey(int key){KEYVAL=key;}
 
 void LoraNode::setMaxDevices(byte code)
@@ -77,6 +112,7 @@ void LoraNode::setMaxDevices(byte code)
   NUMDEVCODE=code;
   unsigned int maxid=LR.defDevRange(NUMDEVCODE);
   if (NETADD>maxid) NETADD=maxid; 
+  LR.defNetAddress(NETADD);
 }
      
 unsigned int LoraNode::getMaxDevices(){return pow(2,NUMDEVCODE);}      
@@ -131,80 +167,800 @@ void LoraNode::changeMessageBufferLen(int maxtextlen)
    recbuff=new char[bufflen];
 }
 
-void LoraNode::setAutomaticAck(bool set){autoAK=set;}
+void LoraNode::setAutomaticAck(bool set){autoAK=set;LR.setDupAck(set);}
+void LoraNode::setRetries(byte n){retries=n;}
 
 bool LoraNode::writeMessage(int dest,char* message,int timeout)
-{
-  int i;
-  for (i=0;i<timeout;i++) {if (LR.freeAir()) break;else delay(1);}
-  if (i>=timeout) {return false;}
-  if (LR.sendNetMess(dest,NODEADD,message)<0) {return false;}
-  if (dest==0) return true; 
-  if (!autoAK) return true;
-  int nc=LR.receiveNextMessage(NODEADD,dest,recbuff,bufflen,200);
-  if (nc==0) {return false;}
-  char* ack=LR.getMessage();
-  if (strncmp(ack,"AK",2)!=0) {return false;}
-  return true;
-}
+{return sendFrame(dest,(byte*)message,strlen(message),0,timeout);}
 
 bool LoraNode::newMessAvailable(int timeout)
-{return incomingMessage(0,timeout);}
+{return incomingMessage(0,recbuff,bufflen,timeout);}
 
 bool LoraNode::newMessAvailable(int from,int timeout)
-{return incomingMessage(from,timeout);}
+{return incomingMessage(from,recbuff,bufflen,timeout);}
 
-char* LoraNode::getMessage(){return LR.getMessage();}
+char* LoraNode::getMessage(){return LR.getMessage()+ctrlOff;}
 int  LoraNode::getSender(){return LR.getSender();}
 int  LoraNode::getMarker(){return LR.getMarker();}
   
-bool LoraNode::incomingMessage(int from,int timeout)
-{
-  int nc=LR.receiveNextMessage(NODEADD,from,recbuff,bufflen,timeout);
-  if (nc<=0) return false;
-  if (!autoAK) return true;
-  int sender=LR.getSender();
-  int i;for (i=0;i<300;i++) {if (LR.freeAir()) break;else delay(1);}
-  if (i>=300) {return false;}
-  if (LR.sendNetMess(sender,NODEADD,"AK")<0)   {return false;}
+/* Control messages not for the application (other nodes polls, channel 
+   switch ...) don't stop waiting until timeout. A message kept while waiting
+   for a response (already acknowledged) is returned first. Reception is 
+   interrupted at the deadline of a pending request to acknowledge it */
+bool LoraNode::incomingMessage(int from,byte buff[],int blen,int timeout)
+{
+  WATCH_SCOPE(WatchNodeRx);
+  processChannel();
+  processRequest();
+  if (LR.takeHeldMess(from)>0) {ctrlCode=heldCode;ctrlOff=heldOff;return true;}
+  unsigned long t=millis();
+  long wait=timeout;
+  while (true)
+  {
+    long d=reqDue();
+    bool cut=(d>0)&&((timeout<=0)||(d<wait));
+    if (LR.receiveNextMessage(NODEADD,from,buff,blen,cut?d:wait)>0) {if (ctrlMessage()) break;}
+    else if (!cut) return false;
+    processRequest();
+    if (timeout<=0) continue;
+    if ((wait=(long)timeout-(long)(millis()-t))<=0) return false;
+  }
+  if (!ackDue()) return true;
+  return sendAck(LR.getSender());
+}
+
+/* Broadcasts, polls and requests/responses are not acknowledged */
+bool LoraNode::ackDue()
+{
+  if (!autoAK) return false;
+  return (LR.getDest()!=0)&&(ctrlCode!=CtrlPoll)&&(ctrlCode!=CtrlRequest)&&(ctrlCode!=CtrlResponse);
+}
+
+/* Send implicit header acknowledge just after reception (no CAD: sender is
+   waiting on the same channel) (high priority for duty cycle) */
+bool LoraNode::sendAck(int dest)
+{
+  if (LR.sendAck(dest,NODEADD)<0) {return false;}
   return true;
 }
 
+void LoraNode::setAckSpreadingFactor(byte code){LR.setAckSprFactor(code);}
+
 /************** Expansion for binary data ***************/
 bool LoraNode::writeMessageByte(int dest,byte message[],int messlen,int timeout)
 {
+  return sendFrame(dest,message,messlen,0,timeout);
+}
+
+/* Frame that exceeds duty cycle budget (or behind deferred frames) is kept 
+   in queue (entry with qFrame flag on destination and marker flags as port)
+   and sent by flushQueue; it returns false (not acknowledged yet) */
+bool LoraNode::sendFrame(int dest,byte mess[],int len,byte flags,int timeout)
+{
+  deferred=false;
+  if ((LR.getDutyWait(len)==0)&&!framesQueued()) return txFrame(dest,mess,len,flags,timeout);
+  if ((len>batchQueueLen-4)||(qlen+4+len>batchQueueLen)) {LR.getStats()->txDuty++;return false;}
+  if (qlen==0) qtime=millis();
+  byte* e=&qbuff[qlen];
+  e[0]=highByte(dest|qFrame);e[1]=lowByte(dest);e[2]=flags;e[3]=len;
+  memcpy(&e[4],mess,len);
+  qlen+=4+len;
+  traceEvent(EvQueue,flags,qlen);
+  deferred=true;
+  return false;
+}
+
+bool LoraNode::framesQueued()
+{
+  for (int i=0;i<qlen;i+=4+qbuff[i+3]) if (qbuff[i]&highByte(qFrame)) return true;
+  return false;
+}
+
+bool LoraNode::isDeferred(){return deferred;}
+
+bool LoraNode::txFrame(int dest,byte mess[],int len,byte flags,int timeout)
+{
+  WATCH_SCOPE(WatchNodeSend);
+  processChannel();
+  processRequest();
+  for (int r=0;;r++)
+  {
+    int i;
+    for (i=0;i<timeout;i++) {if (cad()) break;else delay(1);}
+    if (i>=timeout) {LR.getStats()->cadGiveUp++;return false;}
+    LR.setRetry(r>0);
+    if (LR.sendNetMess(dest,NODEADD,mess,len,flags)<0) {return false;}
+    if (dest==0) return true; 
+    if (!autoAK) return true;
+    bool ak=LR.waitAck(NODEADD,dest,ackTout);
+    txResult(dest,ak);
+    if (ak||(r>=retries)) return ak;
+    unsigned long w=SX.getLoraTimeOnAir(LR.getFrameLen(len))/1000+ackTout;
+    delay(w+random(3*w));                       //frame+acknowledge, 1 to 4 times
+  }
+}
+
+bool LoraNode::newMessByteAvailable(int from,byte binbuff[],int bufflen,int timeout)
+{return incomingMessage(from,binbuff,bufflen,timeout);}
+
+byte* LoraNode::getMessageByte(){return (byte*)LR.getMessage()+ctrlOff;}
+
+int LoraNode::getNumByteReceived() {return LR.getReceivedMessLen()-ctrlOff;}
+
+/************** Broadcast poll with slotted replies ***************/
+
+/* Check control header of last message received. Polls for this node are 
+   accepted (ctrlOff skips the header), channel switch is scheduled and
+   any other control message (or shorter than its header) is discarded */
+bool LoraNode::ctrlMessage()
+{
+  ctrlCode=0;
+  ctrlOff=0;
+  if (!(LR.getMarker()&MarkCtrl)) return true;
+  byte* m=(byte*)LR.getMessage();
+  int len=LR.getReceivedMessLen();
+  if (len<2) return false;
+  if (m[0]==CtrlBatch) {ctrlCode=CtrlBatch;ctrlOff=2;return true;}
+  if (m[0]==CtrlResponse) {ctrlCode=CtrlResponse;ctrlOff=2;return true;}
+  if (m[0]==CtrlRequest)
+  {
+    if ((LR.getDest()==0)||(len<reqHdrLen)) return false;
+    if (reqFrom!=0) processRequest();        //previous request still pending
+    reqTime=millis();
+    reqFrom=LR.getSender();
+    reqRxId=m[1];
+    reqResp=word(m[2]&0x7F,m[3]);
+    reqNoAck=m[2]&0x80;
+    reqTag=LR.getAckTag();
+    reqAcked=false;
+    ctrlCode=CtrlRequest;
+    ctrlOff=reqHdrLen;
+    return true;
+  }
+  if (m[0]==CtrlChSwitch)
+  {
+    if ((len<4)||(m[1]>=nch)) return false;
+    unsigned long toa=SX.getLoraTimeOnAir(LR.getFrameLen(4))/1000;
+    unsigned int rem=word(m[2],m[3]);
+    swCh=m[1];
+    swTime=millis()+(rem>toa?rem-toa:0);
+    swPend=true;
+    return false;
+  }
+  if ((m[0]!=CtrlPoll)||(len<pollHdrLen)||(m[4]>maxPollSlots)) return false;
+  int first=word(m[2],m[3]);
+  int k=NODEADD-first;
+  if ((k<0)||(k>=m[4])) return false;
+  pollTime=millis();
+  pollCoord=LR.getSender();
+  pollId=m[1];
+  pollFirst=first;
+  pollCount=m[4];
+  pollSlot=word(m[5],m[6]);
+  pollRnd=m[7]&1;
+  ctrlCode=CtrlPoll;
+  ctrlOff=pollHdrLen;
+  return true;
+}
+
+int LoraNode::pollBroadcast(byte request[],int reqlen,int first,int count,int maxlen,bool randomSlot,PollReplyHandler handler)
+{
+  if (count>maxPollSlots) count=maxPollSlots;
+  if (count<1) return 0;
+  int flen=LR.getFrameLen(maxlen+3);           //reply frame length
+  if (flen>bufflen) changeMessageBufferLen(flen);
+  pollSlot=SX.getLoraTimeOnAir(flen)/1000+defSlotGuard;
+  pollId++;
+  pollFirst=first;
+  pollCount=count;
+  memset(pollMap,0,sizeof(pollMap));
+  
+  int plen=pollHdrLen+reqlen;
+  byte* pbuff=new byte[plen];
+  pbuff[0]=CtrlPoll;pbuff[1]=pollId;
+  pbuff[2]=highByte(first);pbuff[3]=lowByte(first);pbuff[4]=count;
+  pbuff[5]=highByte(pollSlot);pbuff[6]=lowByte(pollSlot);pbuff[7]=randomSlot;
+  memcpy(&pbuff[pollHdrLen],request,reqlen);
+  int i;for (i=0;i<300;i++) {if (cad()) break;else delay(1);}
+  int ret=LR.sendNetMess(0,NODEADD,pbuff,plen,MarkCtrl);
+  delete[] pbuff;
+  if ((i>=300)||(ret<0)) return 0;
+  pollTime=millis();
+  
+  unsigned long window=(unsigned long)count*pollSlot+defSlotGuard;
+  int nrep=0;
+  LR.receiveMessMode();
+  while (millis()-pollTime<window)
+  {
+    if (LR.receiveNetMess(NODEADD,0,recbuff,bufflen)<=0) {delay(1);continue;}
+    byte* m=(byte*)LR.getMessage();
+    if (!(LR.getMarker()&MarkCtrl)||(LR.getReceivedMessLen()<3)) continue;
+    if ((m[0]!=CtrlPollRep)||(m[1]!=pollId)||(m[2]>LR.getReceivedMessLen()-3)) continue;
+    int k=LR.getSender()-first;
+    if ((k<0)||(k>=count)) continue;
+    if (!bitRead(pollMap[k/8],k%8)) nrep++;
+    bitSet(pollMap[k/8],k%8);
+    if (handler!=NULL) handler(LR.getSender(),&m[3],m[2]);
+  }
+  SX.setState(STDBY);
+  
+  byte abuff[5+maxPollSlots/8];                //bitmap ACK
+  int nb=(count+7)/8;
+  abuff[0]=CtrlPollAck;abuff[1]=pollId;
+  abuff[2]=highByte(first);abuff[3]=lowByte(first);abuff[4]=count;
+  memcpy(&abuff[5],pollMap,nb);
+  LR.setPriority(true);
+  LR.sendNetMess(0,NODEADD,abuff,5+nb,MarkCtrl);
+  LR.setPriority(false);
+  return nrep;
+}
+
+bool LoraNode::pollReplied(int node)
+{
+  int k=node-pollFirst;
+  if ((k<0)||(k>=pollCount)) return false;
+  return bitRead(pollMap[k/8],k%8);
+}
+
+bool LoraNode::isPoll(){return (ctrlCode==CtrlPoll)&&(pollCoord!=0);}
+
+bool LoraNode::replyToPoll(byte data[],int len)
+{
+  if (pollCoord==0) return false;
+  int coord=pollCoord;
+  pollCoord=0;
+  int slot;
+  if (pollRnd) slot=random(pollCount); else slot=NODEADD-pollFirst;
+  int rlen=len+3;
+  byte* rbuff=new byte[rlen];
+  rbuff[0]=CtrlPollRep;rbuff[1]=pollId;rbuff[2]=len;
+  memcpy(&rbuff[3],data,len);
+  unsigned long start=pollTime+(unsigned long)slot*pollSlot+defSlotGuard/2;
+  while ((long)(millis()-start)<0) delay(1);
+  int ret=LR.sendNetMess(coord,NODEADD,rbuff,rlen,MarkCtrl);
+  delete[] rbuff;
+  if (ret<0) return false;
+  
+  int nb=(pollCount+7)/8;                      //wait for bitmap ACK
+  unsigned long atime=SX.getLoraTimeOnAir(LR.getFrameLen(5+nb))/1000;
+  unsigned long end=pollTime+(unsigned long)pollCount*pollSlot+atime+2*defSlotGuard;
+  long wait;
+  while ((wait=(long)(end-millis()))>0)
+  {
+    if (LR.receiveNextMessage(NODEADD,coord,recbuff,bufflen,wait)<=0) break;
+    byte* m=(byte*)LR.getMessage();
+    if (!(LR.getMarker()&MarkCtrl)||(LR.getReceivedMessLen()<5)) continue;
+    if ((m[0]!=CtrlPollAck)||(m[1]!=pollId)) continue;
+    int k=NODEADD-word(m[2],m[3]);
+    if ((k<0)||(k>=m[4])||(LR.getReceivedMessLen()<5+k/8+1)) return false;
+    return bitRead(m[5+k/8],k%8);
+  }
+  return false;
+}
+
+/************** Request/response ***************/
+
+/* Response time is sent with 15 bits; high bit tells responder that no
+   standalone acknowledge is waited (RPC requests) */
+int LoraNode::sendRequest(int dest,byte req[],int reqlen,unsigned int respTime,bool noAck,int timeout)
+{
+  processChannel();
+  processRequest();
+  if (dest==0) return -1;
+  if (respTime>reqMaxResp) respTime=reqMaxResp;
+  if (noAck) respTime|=0x8000;
   int i;
-  for (i=0;i<timeout;i++) {if (LR.freeAir()) break;else delay(1);}
-  if (i>=timeout) {return false;}
-  if (LR.sendNetMess(dest,NODEADD,message)<0) {return false;}
-  if (dest==0) return true; 
-  if (!autoAK) return true;
-  int nc=LR.receiveNextMessage(NODEADD,dest,recbuff,bufflen,200);
-  if (nc==0) {return false;}
-  char* ack=LR.getMessage();
-  if (strncmp(ack,"AK",2)!=0) {return false;}
+  for (i=0;i<timeout;i++) {if (cad()) break;else delay(1);}
+  if (i>=timeout) {LR.getStats()->cadGiveUp++;return -1;}
+  int rlen=reqHdrLen+reqlen;
+  byte* rbuff=new byte[rlen];
+  if (++reqId==0) reqId=1;
+  rbuff[0]=CtrlRequest;rbuff[1]=reqId;
+  rbuff[2]=highByte(respTime);rbuff[3]=lowByte(respTime);
+  memcpy(&rbuff[reqHdrLen],req,reqlen);
+  int ret=LR.sendNetMess(dest,NODEADD,rbuff,rlen,MarkCtrl);
+  delete[] rbuff;
+  if (ret<0) return -1;
+  return reqId;
+}
+
+int LoraNode::request(int dest,byte req[],int reqlen,unsigned int respTime,int timeout)
+{
+  WATCH_SCOPE(WatchRequest);
+  if (respTime>reqMaxResp) respTime=reqMaxResp;
+  if (sendRequest(dest,req,reqlen,respTime,false,timeout)<0) return -1;
+  unsigned long tag=LR.getAckTag();
+  unsigned long t=millis();
+  
+  long wait;
+  while ((wait=(long)respTime-(long)(millis()-t))>0)
+  {
+    if (LR.receiveNextMessage(NODEADD,dest,recbuff,bufflen,wait)<=0) break;
+    if (!ctrlMessage()) continue;
+    if (rpcMatch()) continue;
+    if ((ctrlCode!=CtrlResponse)||(((byte*)LR.getMessage())[1]!=reqId)) {holdMessage();continue;}
+    txResult(dest,true);
+    return getNumByteReceived();
+  }
+  ctrlCode=0;ctrlOff=0;
+  bool ak=LR.waitAck(NODEADD,dest,tag,ackTout);
+  txResult(dest,ak);
+  if (ak) return 0;
+  return -1;
+}
+
+bool LoraNode::isRequest(){return (ctrlCode==CtrlRequest)&&(reqFrom!=0);}
+bool LoraNode::isResponse(){return ctrlCode==CtrlResponse;}
+
+unsigned long LoraNode::respDeadline(){return reqTime+reqResp;}
+
+/* Another message of dest while waiting for the response: it is kept for 
+   the next newMessAvailable() and acknowledged now (sender is waiting). If a
+   message is already kept it is not acknowledged: its sender will retry */
+void LoraNode::holdMessage()
+{
+  if (!LR.holdMess()) return;
+  heldCode=ctrlCode;heldOff=ctrlOff;
+  if (ackDue()) sendAck(LR.getSender());
+}
+
+/* Response is in time only if it ends before the deadline (less a guard for
+   reception latency); otherwise it is not sent (requester doesn't wait for it
+   any more) and the standalone acknowledge is sent at deadline by 
+   processRequest(). Responses to RPC requests (many can be in flight) are 
+   sent after CAD */
+bool LoraNode::respond(byte data[],int len)
+{
+  if (reqFrom==0) return false;
+  int rlen=2+len;
+  unsigned long toa=SX.getLoraTimeOnAir(LR.getFrameLen(rlen))/1000+1;
+  if ((long)(millis()+toa+respGuard-respDeadline())>0) 
+  {
+    if (reqNoAck) reqFrom=0; else processRequest();
+    return false;
+  }
+  int dest=reqFrom;
+  reqFrom=0;
+  byte* rbuff=new byte[rlen];
+  rbuff[0]=CtrlResponse;rbuff[1]=reqRxId;
+  memcpy(&rbuff[2],data,len);
+  int i=0;
+  if (reqNoAck) for (i=0;i<300;i++) {if (cad()) break;else delay(1);}
+  int ret=-1;
+  if (i<300) ret=LR.sendNetMess(dest,NODEADD,rbuff,rlen,MarkCtrl);
+  delete[] rbuff;
+  return ret>=0;
+}
+
+long LoraNode::reqDue()
+{
+  if ((reqFrom==0)||reqAcked||reqNoAck) return 0;
+  long d=(long)(respDeadline()-millis());
+  return (d>0)?d:0;
+}
+
+bool LoraNode::processRequest()
+{
+  if ((reqFrom==0)||reqAcked||reqNoAck) return false;
+  if ((long)(millis()-respDeadline())<0) return false;
+  reqAcked=true;
+  if (millis()-respDeadline()>ackTout) return false;
+  return LR.sendAck(reqFrom,NODEADD,reqTag)>=0;
+}
+
+/************** Pipelined requests (RPC) ***************/
+
+int LoraNode::rpcSend(int dest,byte req[],int reqlen,unsigned int respTime,RpcHandler handler)
+{
+  int k=-1;
+  for (int i=0;i<maxRpcPending;i++) if (rpcTab[i].state==RpcFree) {k=i;break;}
+  if (k<0) return -1;                          //results not released are kept
+  int id=sendRequest(dest,req,reqlen,respTime,true,batchCADtout);
+  if (id<0) return -1;
+  RpcEntry &e=rpcTab[k];
+  e.id=id;
+  e.node=dest;
+  e.deadline=millis()+(respTime>reqMaxResp?reqMaxResp:respTime);
+  e.handler=handler;
+  e.len=0;
+  e.state=RpcPending;
+  return id;
+}
+
+/* Complete entry: handler (entry released) or stored result for polling */
+void LoraNode::rpcComplete(RpcEntry &e,byte state,byte* data,int len)
+{
+  e.state=state;
+  if (len>maxRpcResp) len=maxRpcResp;
+  if (len<0) len=0;
+  e.len=len;
+  if (e.handler!=NULL) {e.handler(e.id,e.node,state,data,len);e.state=RpcFree;return;}
+  memcpy(e.data,data,len);
+}
+
+/* If last message received is a response of a pending RPC, complete it */
+bool LoraNode::rpcMatch()
+{
+  if (ctrlCode!=CtrlResponse) return false;
+  byte id=((byte*)LR.getMessage())[1];
+  for (int i=0;i<maxRpcPending;i++)
+  {
+    RpcEntry &e=rpcTab[i];
+    if ((e.state!=RpcPending)||(e.id!=id)||((unsigned int)e.node!=LR.getSender())) continue;
+    txResult(e.node,true);
+    rpcComplete(e,RpcDone,getMessageByte(),getNumByteReceived());
+    return true;
+  }
+  return false;
+}
+
+void LoraNode::rpcExpire()
+{
+  for (int i=0;i<maxRpcPending;i++)
+  {
+    RpcEntry &e=rpcTab[i];
+    if ((e.state!=RpcPending)||((long)(millis()-e.deadline)<0)) continue;
+    txResult(e.node,false);
+    rpcComplete(e,RpcTimeout,NULL,0);
+  }
+}
+
+bool LoraNode::rpcPoll(int timeout)
+{
+  unsigned long t=millis();
+  long wait;
+  while (true)
+  {
+    rpcExpire();
+    wait=(long)timeout-(long)(millis()-t);
+    if (wait<=0) return false;
+    for (int i=0;i<maxRpcPending;i++)          //wake up at next deadline
+      if (rpcTab[i].state==RpcPending) 
+        {long d=(long)(rpcTab[i].deadline-millis());if (d<wait) wait=d;}
+    if (wait<10) wait=10;
+    if (!incomingMessage(0,recbuff,bufflen,wait)) continue;
+    if (rpcMatch()) continue;
+    return true;
+  }
+}
+
+int LoraNode::rpcPending()
+{
+  int n=0;
+  for (int i=0;i<maxRpcPending;i++) if (rpcTab[i].state==RpcPending) n++;
+  return n;
+}
+
+int LoraNode::rpcFind(byte id)
+{
+  for (int i=0;i<maxRpcPending;i++) 
+    if ((rpcTab[i].state!=RpcFree)&&(rpcTab[i].id==id)) return i;
+  return -1;
+}
+
+byte LoraNode::rpcState(byte id)
+{
+  int k=rpcFind(id);
+  if (k<0) return RpcFree;
+  return rpcTab[k].state;
+}
+
+byte* LoraNode::rpcResult(byte id,int* len)
+{
+  int k=rpcFind(id);
+  if ((k<0)||(rpcTab[k].state!=RpcDone)) return NULL;
+  *len=rpcTab[k].len;
+  return rpcTab[k].data;
+}
+
+void LoraNode::rpcRelease(byte id)
+{
+  int k=rpcFind(id);
+  if ((k>=0)&&(rpcTab[k].state!=RpcPending)) rpcTab[k].state=RpcFree;
+}
+
+/************** Message aggregation ***************/
+
+void LoraNode::setBatchDelay(unsigned int ms){batchDelay=ms;}
+
+bool LoraNode::queueMessage(int dest,byte port,byte message[],int messlen)
+{
+  if ((messlen<0)||(messlen>maxBatchLen-2)) return false;
+  if (qlen+4+messlen>batchQueueLen) flushQueue();
+  if (qlen+4+messlen>batchQueueLen) return false;
+  if (qlen==0) qtime=millis();
+  byte* e=&qbuff[qlen];
+  e[0]=highByte(dest);e[1]=lowByte(dest);e[2]=port;e[3]=messlen;
+  memcpy(&e[4],message,messlen);
+  qlen+=4+messlen;
+  traceEvent(EvQueue,port,qlen);
+  if (batchDelay==0) flushQueue();
   return true;
 }
 
-bool LoraNode::newMessByteAvailable(int from,byte binbuff[],int bufflen,int timeout)
+int LoraNode::processQueue()
+{
+  processChannel();
+  processRequest();
+  if (qlen==0) return 0;
+  if (millis()-qtime<batchDelay) return 0;
+  return flushQueue();
+}
+
+/* Every frame groups messages of the first destination in queue; 
+   messages for other nodes (or exceeding the frame) are kept in queue.
+   Messages of a frame not sent (or not acknowledged) are kept too, moved
+   before "skip" so other destinations are served; they are tried again
+   after batch delay. Frames deferred for duty cycle (qFrame) are sent 
+   alone, in order. Messages are kept in queue while duty cycle budget is
+   low */
+int LoraNode::flushQueue()
+{
+  WATCH_SCOPE(WatchFlush);
+  int nf=0;
+  int skip=0;                                  //queue part of failed frames
+  byte fbuff[2+maxBatchLen];
+  byte e[4+maxBatchLen];
+  while (qlen>skip)
+  {
+    unsigned int dest=word(qbuff[skip],qbuff[skip+1]);
+    int n=1;
+    bool ok;
+    if (dest&qFrame)
+    {
+      if (LR.getDutyWait(qbuff[skip+3])>0) break;
+      ok=txFrame(dest&~qFrame,&qbuff[skip+4],qbuff[skip+3],qbuff[skip+2],batchCADtout);
+    }
+    else
+    {
+      int flen=2;n=0;
+      for (int i=skip;i<qlen;i+=4+qbuff[i+3])
+      {
+        int elen=4+qbuff[i+3];
+        if (word(qbuff[i],qbuff[i+1])!=dest) continue;
+        if (flen+elen-2>2+maxBatchLen) break;
+        memcpy(&fbuff[flen],&qbuff[i+2],elen-2);flen+=elen-2;n++;
+      }
+      fbuff[0]=CtrlBatch;fbuff[1]=n;
+      if (LR.getDutyWait(flen)>0) break;
+      ok=txFrame(dest,fbuff,flen,MarkCtrl,batchCADtout);
+    }
+    if (ok) nf++;
+    int i=skip;
+    while (i<qlen)
+    {
+      int elen=4+qbuff[i+3];
+      if (word(qbuff[i],qbuff[i+1])!=dest) {i+=elen;continue;}
+      if (ok) 
+      {
+        if (n--==0) break;
+        memmove(&qbuff[i],&qbuff[i+elen],qlen-i-elen);qlen-=elen;
+        continue;
+      }
+      memcpy(e,&qbuff[i],elen);
+      memmove(&qbuff[skip+elen],&qbuff[skip],i-skip);
+      memcpy(&qbuff[skip],e,elen);
+      skip+=elen;i+=elen;
+    }
+  }
+  if (skip>0) qtime=millis();
+  if (nf>0) traceEvent(EvFlush,0,nf);
+  return nf;
+}
+
+bool LoraNode::isBatch(){return ctrlCode==CtrlBatch;}
+
+int LoraNode::getBatchCount()
+{
+  if (ctrlCode!=CtrlBatch) return 0;
+  return ((byte*)LR.getMessage())[1];
+}
+
+byte* LoraNode::getBatchMessage(int i,byte* port,int* len)
+{
+  if ((i<0)||(i>=getBatchCount())) return NULL;
+  byte* e=(byte*)LR.getMessage()+2;
+  byte* end=(byte*)LR.getMessage()+LR.getReceivedMessLen();
+  while (i-->0) {e=e+2+e[1];if (e+2>end) return NULL;}
+  if (e+2+e[1]>end) return NULL;
+  *port=e[0];
+  *len=e[1];
+  return &e[2];
+}
+
+/********************************************************/
+
+/************** Multi-channel operation ***************/
+
+void LoraNode::setChannelPlan(unsigned long freqHz[],byte n)
+{
+  if (n>maxChannels) n=maxChannels;
+  for (int i=0;i<n;i++) chTab[i]=SX.makeChannel(freqHz[i]);
+  nch=n;
+  swPend=false;
+  resetChannelStats();
+  if (n>0) setChannel(0);
+}
+
+bool LoraNode::setChannel(byte ch)
 {
-  int nc=LR.receiveNextMessage(NODEADD,from,binbuff,bufflen,timeout);
-  if (nc<=0) return false;
-  if (!autoAK) return true;
-  int sender=LR.getSender();
-  int i;for (i=0;i<300;i++) {if (LR.freeAir()) break;else delay(1);}
-  if (i>=300) {return false;}
-  if (LR.sendNetMess(sender,NODEADD,"AK")<0)   {return false;}
+  if (ch>=nch) return false;
+  curch=ch;
+  FREQ=getChannelFreq(ch)/1000000.0;
+  if (factive) {SX.setState(STDBY);SX.setChannel(chTab[ch]);}
   return true;
 }
 
-byte* LoraNode::getMessageByte(){return LR.getMessage();}
+byte LoraNode::getChannel(){return curch;}
+byte LoraNode::getChannelCount(){return nch;}
+
+unsigned long LoraNode::getChannelFreq(byte ch)
+{
+  if (ch>=nch) return 0;
+  SXChannel &c=chTab[ch];
+  return SX.frfToHz(((unsigned long)c.frf[0]<<16)|((unsigned long)c.frf[1]<<8)|c.frf[2]);
+}
+
+float LoraNode::getChannelBusy(byte ch)
+{
+  if ((ch>=nch)||(cadTot[ch]==0)) return 0;
+  return (float)cadBusy[ch]/cadTot[ch];
+}
+
+float LoraNode::getChannelLoss(byte ch)
+{
+  if ((ch>=nch)||(txTot[ch]==0)) return 0;
+  return (float)txLost[ch]/txTot[ch];
+}
+
+void LoraNode::resetChannelStats()
+{
+  memset(cadTot,0,sizeof(cadTot));memset(cadBusy,0,sizeof(cadBusy));
+  memset(txTot,0,sizeof(txTot));memset(txLost,0,sizeof(txLost));
+}
+
+byte LoraNode::scanChannels(int probes)
+{
+  byte cur=curch;
+  for (byte ch=0;ch<nch;ch++)
+  {
+    setChannel(ch);
+    for (int i=0;i<probes;i++) cad();
+  }
+  setChannel(cur);
+  return bestChannel();
+}
+
+byte LoraNode::bestChannel()
+{
+  byte best=curch;
+  float bscore=getChannelBusy(curch)+getChannelLoss(curch);
+  for (byte ch=0;ch<nch;ch++)
+  {
+    float score=getChannelBusy(ch)+getChannelLoss(ch);
+    if (score<bscore) {best=ch;bscore=score;}
+  }
+  return best;
+}
+
+/* Every announcement carries the remaining time to switch, so nodes 
+   receiving any of them agree on the same switch time */
+bool LoraNode::announceChannelSwitch(byte ch,unsigned int delayMs)
+{
+  if (ch>=nch) return false;
+  unsigned long start=millis();
+  unsigned long toa=SX.getLoraTimeOnAir(LR.getFrameLen(4))/1000;
+  int nsent=0;
+  byte abuff[4];
+  abuff[0]=CtrlChSwitch;abuff[1]=ch;
+  for (int k=0;k<defSwitchRep;k++)
+  {
+    unsigned long el=millis()-start;
+    if (el+toa>=delayMs) break;
+    unsigned int rem=delayMs-el;
+    abuff[2]=highByte(rem);abuff[3]=lowByte(rem);
+    int i;for (i=0;i<300;i++) {if (cad()) break;else delay(1);}
+    LR.setPriority(true);
+    if ((i<300)&&(LR.sendNetMess(0,NODEADD,abuff,4,MarkCtrl)>=0)) nsent++;
+    LR.setPriority(false);
+    delay(random(defSlotGuard,2*defSlotGuard));
+  }
+  swCh=ch;
+  swTime=start+delayMs;
+  swPend=true;
+  return nsent>0;
+}
+
+bool LoraNode::processChannel()
+{
+  if (!swPend) return false;
+  if ((long)(millis()-swTime)<0) return false;
+  swPend=false;
+  return setChannel(swCh);
+}
+
+/* CAD counted on busy ratio of current channel */
+bool LoraNode::cad()
+{
+  bool free=LR.freeAir();
+  if (nch>0) chCount(cadTot,cadBusy,!free);
+  LoraStats* s=LR.getStats();
+  s->cadRuns++;
+  if (!free) s->cadBusy++;
+  traceEvent(EvCad,free,0);
+  return free;
+}
 
-int LoraNode::getNumByteReceived() {return LR.getReceivedMessLen();}
+/* Message to dest acknowledged (or answered) or not: channel loss, MAC 
+   counters and peer delivery ratio (retry: sent again to the node of the 
+   last failure) */
+void LoraNode::txResult(int dest,bool ak)
+{
+  if (nch>0) chCount(txTot,txLost,!ak);
+  LoraStats* s=LR.getStats();
+  s->macTx++;
+  if (dest==lastFail) {s->macRetry++;traceEvent(EvRetry,0,dest);}
+  lastFail=ak?0:dest;
+  LoraPeer* p=LR.getPeer(dest,true);
+  if (p==NULL) return;
+  p->tx++;
+  if (ak) p->txAck++;
+}
+
+/* Counters are halved to follow recent channel conditions */
+void LoraNode::chCount(unsigned int tot[],unsigned int ev[],bool e)
+{
+  tot[curch]++;
+  if (e) ev[curch]++;
+  if (tot[curch]>=chStatMax) {tot[curch]/=2;ev[curch]/=2;}
+}
 
 /********************************************************/
 
-bool LoraNode::freeAir(){return LR.freeAir();}
+bool LoraNode::freeAir(){return cad();}
+
+void LoraNode::setDutyCycle(LoraDuty* dc){LR.setDutyCycle(dc);}
+
+unsigned long LoraNode::getAirBudget(){return LR.getAirBudget();}
+
+void LoraNode::setAfc(LoraAfc* afc){LR.setAfc(afc);}
+void LoraNode::update(){LR.update();}
+
+void LoraNode::setPeerTable(LoraPeers* tb){LR.setPeers(tb);}
+LoraPeer* LoraNode::getPeer(int node){return LR.getPeer(node);}
+
+void LoraNode::snapshotStats(LoraStats* s){LR.snapshotStats(s);}
+void LoraNode::resetStats(){LR.resetStats();lastFail=0;}
+int LoraNode::exportStats(byte* buff,int len){return LR.exportStats(buff,len);}
+
+float LoraNode::getPeerDelivery(int node)
+{
+  LoraPeer* p=LR.getPeer(node);
+  if ((p==NULL)||(p->tx==0)) return 0;
+  return (float)p->txAck/p->tx;
+}
+
+void LoraNode::printStats()
+{
+  LoraStats s;
+  LR.snapshotStats(&s);
+  Serial.print("Tx frames: ");Serial.print(s.txFrames);Serial.print("  fail: ");Serial.print(s.txFail);
+  Serial.print("  duty: ");Serial.print(s.txDuty);Serial.print("  air (ms): ");Serial.println(s.txAirMs);
+  Serial.print("Rx frames: ");Serial.print(s.rxFrames);Serial.print("  CRC err: ");Serial.print(s.rxCrcErr);
+  Serial.print("  foreign: ");Serial.print(s.rxForeign);Serial.print("  mess: ");Serial.print(s.rxMess);
+  Serial.print("  dups: ");Serial.println(s.rxDups);
+  Serial.print("Ack sent: ");Serial.print(s.ackSent);Serial.print("  ok: ");Serial.print(s.ackOk);
+  Serial.print("  timeout: ");Serial.println(s.ackTimeout);
+  Serial.print("MAC tx: ");Serial.print(s.macTx);Serial.print("  retry: ");Serial.print(s.macRetry);
+  Serial.print("  CAD: ");Serial.print(s.cadRuns);Serial.print("  busy: ");Serial.print(s.cadBusy);
+  Serial.print("  give up: ");Serial.println(s.cadGiveUp);
+  Serial.print("Last RSSI: ");Serial.print(s.rssi);Serial.print("  SNR: ");Serial.println(s.snr);
+  Serial.print("RSSI hist:");
+  for (int i=0;i<statBins;i++) {Serial.print(' ');Serial.print(s.rssiHist[i]);}
+  Serial.print("  SNR hist:");
+  for (int i=0;i<statBins;i++) {Serial.print(' ');Serial.print(s.snrHist[i]);}
+  Serial.println();
+}
 
 void LoraNode::loadNetConfig()
 {
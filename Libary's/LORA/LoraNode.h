@@ -32,9 +32,19 @@
 *  The received message is returned by getMessage() function and sender is 
 *  returned by getSender() function.
 *  Sending and receiving message can work with automatic acknowledge. That is, 
-*  sending message waits few milliseconds for "AK" message replay and receiving 
-*  sends replay "AK" message.
+*  sending message waits few milliseconds for acknowledge and receiving sends 
+*  it (short implicit header frame, see LORA::sendAck).
 *  Any message contain a random byte that ca be read by getMarker() function.               
+*  A coordinator can collect replies of many nodes with a single broadcast poll
+*  (pollBroadcast()); nodes answer in time slots (replyToPoll()) and a single 
+*  bitmap acknowledge covers all replies.
+*  Small messages can be queued (queueMessage()) and are sent grouped in a 
+*  single frame for each destination node, when batch delay expires.
+*  A request (request()) is acknowledged by its response (respond()): a 
+*  separate acknowledge is sent only if response is not ready in time.
+*  With a channel plan (setChannelPlan()) the network can move to the least 
+*  busy channel: a coordinator announces the switch (announceChannelSwitch())
+*  and all nodes change channel at the same agreed time.
 *    
 * Author: Daniele Denaro 2018
 * Version 3.0
@@ -61,6 +71,61 @@
 
 #define receiveBufferLen 64      //Default length of receiving buffer
 
+#define maxPollSlots 64          //Max nodes addressed by a broadcast poll
+#define defSlotGuard 40          //Guard time added to each reply slot (ms)
+#define ackTout      200         //Max wait for acknowledge (ms)
+
+/* LoraNode control codes (first byte of messages marked with MarkCtrl) */
+#define CtrlPoll    0x01         //broadcast poll
+#define CtrlPollRep 0x02         //reply to broadcast poll
+#define CtrlPollAck 0x03         //bitmap acknowledge of poll replies
+
+#define CtrlBatch   0x04         //group of queued messages
+#define CtrlChSwitch 0x05        //channel switch announcement
+#define CtrlRequest 0x06         //request waiting for response
+#define CtrlResponse 0x07        //response to request (it acknowledges request)
+
+#define reqHdrLen   4            //request control header length
+#define respGuard   30           //response must end this time before deadline (ms)
+#define reqMaxResp  32767        //max response time (ms)
+
+#define maxRpcPending 8          //max requests in flight (RPC)
+#define maxRpcResp    24         //max response bytes kept for polling
+
+/* RPC states */
+#define RpcFree     0            //no request with this id
+#define RpcPending  1            //waiting for response
+#define RpcDone     2            //response received
+#define RpcTimeout  3            //no response within response time
+
+#define pollHdrLen  8            //poll control header length
+
+#define batchQueueLen 128        //Queue buffer for messages waiting to be grouped
+#define maxBatchLen   59         //Max bytes of messages grouped in one frame
+#define batchCADtout  500        //Max wait for free air sending a group (ms)
+#define qFrame        0x8000     //Queue entry is a frame deferred for duty cycle
+
+#define maxChannels   8          //Max channels of channel plan
+#define chStatMax     1024       //Channel counters are halved at this value
+#define defSwitchRep  3          //Repetitions of channel switch announcement
+
+/* Function called by pollBroadcast for every reply received */
+typedef void (*PollReplyHandler)(int node, byte* data, int len);
+
+/* Function called by rpcPoll when a request completes (state RpcDone or RpcTimeout) */
+typedef void (*RpcHandler)(byte id, int node, byte state, byte* data, int len);
+
+struct RpcEntry
+{
+  byte id;
+  byte state;
+  int node;
+  unsigned long deadline;
+  RpcHandler handler;
+  byte len;
+  byte data[maxRpcResp];         //response (polling completion)
+};
+
 class LoraNode
 {
   public:
@@ -75,6 +140,12 @@ class LoraNode
 
 /* Start Lora radio module. If can't use module it returns false. */ 
   bool begin();
+/* Start after MCU deep sleep: radio reset and configuration are skipped if 
+   radio registers match signature sig (saved from getSignature() after 
+   begin, ex. in ESP32 RTC_DATA_ATTR variable); otherwise as begin(). 
+   Radio must be kept powered (in SLEEP) during deep sleep */
+  bool begin(unsigned int sig);
+  unsigned int getSignature();
   
 /* Send message to dest node (of this network id) */
   bool writeMessage(int dest,char* message,int timeout);
@@ -98,6 +169,11 @@ class LoraNode
  
 /* Set automatic replay for mess. received and wait for replay of mess. sent (def. yes)*/
   void setAutomaticAck(bool yes); 
+/* Retransmissions of a message not acknowledged (def. 0), after a random 
+   wait (1 to 4 times frame airtime plus acknowledge timeout). They keep the sequence number: with 
+   sequence numbers on (LR.setSequence(true)) and a peer table, the receiver 
+   discards them as duplicates and acknowledges them again */
+  void setRetries(byte n);
 
 /* Set this node address (node id)*/  
   void setNodeAdd(unsigned int nodeAdd);
@@ -140,10 +216,41 @@ class LoraNode
   void setSpreadingFactor(byte code);
 /* Set BW (change default value) */  
   void setBandWidth(byte code);
+/* Set spreading factor of acknowledges (0: same of messages (def.), 6: fastest)*/
+  void setAckSpreadingFactor(byte code);
   
 /* Test if no communication on air (same freq.,spreading factor,band width)*/
   bool freeAir();
 
+/* Attach duty cycle airtime accountant (see LoraDuty). Acknowledges are sent
+   as high priority. A message (writeMessage/writeMessageByte, max 124 bytes)
+   exceeding the budget, or written while deferred messages are waiting, is 
+   kept in queue (return false, isDeferred() true) and sent in order by 
+   processQueue() when budget is available: call it in the loop. Queued 
+   messages are kept in queue while budget is low */  
+  void setDutyCycle(LoraDuty* dc);
+/* True if last message written has been kept in queue for duty cycle */  
+  bool isDeferred();
+/* Airtime (microseconds) still available on current frequency */  
+  unsigned long getAirBudget();
+/* Attach automatic frequency correction per peer (see LoraAfc) */  
+  void setAfc(LoraAfc* afc);
+/* Idle work (board temperature for frequency correction): call it in the 
+   loop */  
+  void update();
+/* Attach peer table (see LoraPeers) and get record of node (NULL if unknown) */  
+  void setPeerTable(LoraPeers* tb);
+  LoraPeer* getPeer(int node);
+/* Link and MAC statistics (see LoraStats in LORA.h): consistent copy, reset,
+   binary export (LORA::exportStats format) and print on Serial */  
+  void snapshotStats(LoraStats* s);
+  void resetStats();
+  int exportStats(byte* buff,int len);
+  void printStats();
+/* Delivery ratio (0 to 1) of messages sent to node (acknowledged or answered
+   / sent), with peer table; 0 if unknown */  
+  float getPeerDelivery(int node);
+
 /* Change default buffer length that is 64 bytes */  
   void changeMessageBufferLen(int maxMesslen); 
 
@@ -164,11 +271,145 @@ class LoraNode
   byte* getMessageByte();
 /* Get recent bytes number received */  
   int getNumByteReceived();    
+
+/************** Broadcast poll with slotted replies ***************/
+/* Coordinator. Broadcast request to nodes from first to first+count-1 (count 
+   max 64). Every node replies in its slot (node-first) or, if randomSlot is 
+   true, in a random slot. Slots are sized for replies of maxlen bytes. 
+   Each reply is passed to handler (can be NULL) as soon as it arrives.
+   At the end a single bitmap ACK acknowledges all replies received.
+   It returns the number of replies received.*/
+  int pollBroadcast(byte request[],int reqlen,int first,int count,int maxlen,bool randomSlot,PollReplyHandler handler);
+/* Coordinator. True if node replied to last broadcast poll */  
+  bool pollReplied(int node);
+
+/* Device. True if last message received is a broadcast poll for this node.
+   Poll request is returned by getMessage()/getMessageByte() */  
+  bool isPoll();
+/* Device. Reply to last poll in the assigned slot, then wait for bitmap ACK.
+   It returns true if coordinator acknowledged the reply */  
+  bool replyToPoll(byte data[],int len);
+
+/************** Message aggregation ***************/
+/* Set max time (ms) a queued message waits to be grouped with others 
+   (def. 0: queued messages are sent immediately) */
+  void setBatchDelay(unsigned int ms);
+/* Queue message (max 57 bytes) for local endpoint port (0-255) of dest node.
+   Messages for the same node are grouped in one frame: each message is coded 
+   as port, length, message. It returns false if message is too long */  
+  bool queueMessage(int dest,byte port,byte message[],int messlen);
+/* Send grouped messages if batch delay of the oldest one is expired. 
+   Call it in the loop. It returns the number of frames sent */  
+  int processQueue();
+/* Send all queued messages now. It returns the number of frames sent 
+   (acknowledged, with automatic acknowledge); messages of frames not sent
+   stay in queue */
+  int flushQueue();
+/* True if last message received is a group of messages */
+  bool isBatch();
+/* Number of messages in last group received */
+  int getBatchCount();
+/* Get message i (0 to count-1) of last group received, its port and length */  
+  byte* getBatchMessage(int i,byte* port,int* len);
+
+/************** Request/response ***************/
+/* Requester. Send request to dest and wait respTime ms for the response, that 
+   acknowledges the request too. If no response arrives in time, a standalone 
+   acknowledge is waited. Other messages of dest arrived meanwhile are 
+   acknowledged and kept (one) for the next newMessAvailable(). 
+   It returns response length (response is returned by getMessage()/
+   getMessageByte()), 0 if request has been acknowledged without response
+   (isResponse() is true only if a response arrived, even an empty one) or 
+   -1 if request has not been acknowledged */
+  int request(int dest,byte req[],int reqlen,unsigned int respTime,int timeout);
+/* Responder. True if last message received is a request. Request is returned
+   by getMessage()/getMessageByte() */  
+  bool isRequest();
+/* True if last message received is a response: after request(), response
+   received (also empty); after newMessAvailable(), a late response */  
+  bool isResponse();
+/* Responder. Send response to last request: it acknowledges the request. 
+   It returns false if response can't be sent or it is too late (it couldn't
+   end within response time): then the requester doesn't wait for it and 
+   request is acknowledged at deadline (processRequest()) */  
+  bool respond(byte data[],int len);
+/* Responder. Acknowledge pending request when its response time is expired 
+   without response. It is called by send and receive functions, call it in
+   the loop if node is busy. It returns true if acknowledge has been sent */
+  bool processRequest();
+
+/************** Pipelined requests (RPC) ***************/
+/* Send request to dest without waiting: up to 8 requests (to the same or 
+   different nodes) can be in flight. Response must arrive in respTime ms 
+   (max 32767); no standalone acknowledge is used. Completion is passed to 
+   handler or, if handler is NULL, is read by rpcState()/rpcResult() and 
+   the entry is kept until rpcRelease(). It returns request id (1-255) or -1 
+   if request can't be sent or all 8 entries are in use */
+  int rpcSend(int dest,byte req[],int reqlen,unsigned int respTime,RpcHandler handler);
+/* Receive for timeout ms completing requests (responses and expired response 
+   times). It returns true (before timeout) if another message has been received
+   (as newMessAvailable) */  
+  bool rpcPoll(int timeout);
+/* Number of requests waiting for response */  
+  int rpcPending();
+/* State of request id (RpcFree, RpcPending, RpcDone, RpcTimeout) */  
+  byte rpcState(byte id);
+/* Response of request id (max 24 bytes) or NULL if not done */  
+  byte* rpcResult(byte id,int* len);
+/* Release completed request id (polling completion) */  
+  void rpcRelease(byte id);
+
+/************** Multi-channel operation ***************/
+/* Set channel plan (n frequencies in Hz, max 8). Radio registers values are 
+   computed here once; node starts on channel 0 */
+  void setChannelPlan(unsigned long freqHz[],byte n);
+/* Change channel now (only this node). It returns false if ch not in plan */  
+  bool setChannel(byte ch);
+/* Current channel and number of channels in plan */  
+  byte getChannel();
+  byte getChannelCount();
+/* Frequency (Hz) of channel ch */  
+  unsigned long getChannelFreq(byte ch);
+/* Busy ratio (0 to 1) of channel ch, as fraction of CAD found air busy */  
+  float getChannelBusy(byte ch);
+/* Packet loss ratio (0 to 1) of channel ch, as fraction of messages not acknowledged */  
+  float getChannelLoss(byte ch);
+  void resetChannelStats();
+/* Sample every channel with probes CAD and come back to current channel.
+   It returns the best channel */  
+  byte scanChannels(int probes);
+/* Channel with the lowest busy+loss ratio (current channel if equal) */  
+  byte bestChannel();
+/* Coordinator. Broadcast that network moves to channel ch after delayMs 
+   milliseconds (announcement is repeated defSwitchRep times). All nodes 
+   receiving it (and this node) change channel at the same time */  
+  bool announceChannelSwitch(byte ch,unsigned int delayMs);
+/* Apply pending channel switch when its time is reached. It is called by
+   send and receive functions, call it in the loop if node is idle.
+   It returns true if channel has been changed */  
+  bool processChannel();
 /********************************************************/  
   
   private:
   void initDefault();
-  bool incomingMessage(int from,int timeout);
+  bool incomingMessage(int from,byte buff[],int blen,int timeout);
+  bool ctrlMessage();
+  bool sendFrame(int dest,byte mess[],int len,byte flags,int timeout);
+  bool txFrame(int dest,byte mess[],int len,byte flags,int timeout);
+  bool framesQueued();
+  bool sendAck(int dest);
+  bool ackDue();
+  void holdMessage();
+  unsigned long respDeadline();
+  long reqDue();                 //ms to deadline of request to acknowledge (0: none)
+  int sendRequest(int dest,byte req[],int reqlen,unsigned int respTime,bool noAck,int timeout);
+  bool rpcMatch();
+  void rpcExpire();
+  int rpcFind(byte id);
+  void rpcComplete(RpcEntry &e,byte state,byte* data,int len);
+  bool cad();
+  void txResult(int dest,bool ak);
+  void chCount(unsigned int tot[],unsigned int ev[],bool e);
   
   unsigned int NETADD;
   unsigned int NUMDEVCODE;
@@ -188,6 +429,51 @@ class LoraNode
   byte* recbuff;
 
   bool autoAK;
+  byte retries;
+
+  byte ctrlCode;                 //control code of last message (0 if none)
+  int ctrlOff;                   //control header length of last message
+  byte heldCode;                 //ctrlCode/ctrlOff of message kept in LR
+  int heldOff;
+  
+  byte pollId;
+  int pollCoord;                 //coordinator of pending poll (0 if none)
+  int pollFirst;
+  int pollCount;
+  unsigned int pollSlot;         //slot length (ms)
+  bool pollRnd;
+  unsigned long pollTime;        //poll end of transmission/reception
+  byte pollMap[maxPollSlots/8];
+  
+  byte reqId;                    //id of last request sent
+  int reqFrom;                   //requester of pending request (0 if none)
+  byte reqRxId;
+  unsigned long reqTag;          //acknowledge tag of pending request
+  unsigned int reqResp;          //response time (ms)
+  unsigned long reqTime;         //pending request reception time
+  bool reqAcked;
+  bool reqNoAck;                 //requester doesn't wait standalone acknowledge
+  
+  RpcEntry rpcTab[maxRpcPending];
+  
+  unsigned int batchDelay;
+  unsigned long qtime;           //queuing time of oldest message
+  int qlen;
+  byte qbuff[batchQueueLen];     //entries: dest(2) port len message
+  bool deferred;                 //last message written kept in queue
+  
+  int lastFail;                  //node of last message not acknowledged
+  
+  byte nch;                      //channels in plan (0 if no plan)
+  byte curch;
+  SXChannel chTab[maxChannels];  //precomputed radio registers of channels
+  unsigned int cadTot[maxChannels];
+  unsigned int cadBusy[maxChannels];
+  unsigned int txTot[maxChannels];
+  unsigned int txLost[maxChannels];
+  bool swPend;                   //channel switch pending
+  byte swCh;
+  unsigned long swTime;          //time of channel switch
 
 };
 
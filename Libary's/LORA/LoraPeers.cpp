@@ -0,0 +1,92 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraPeers.h"
+
+LoraPeers::LoraPeers(unsigned int slots){init(slots);}
+LoraPeers::LoraPeers(){init(defPeerSlots);}
+
+void LoraPeers::init(unsigned int slots)
+{
+  bits=3;
+  while (((1U<<bits)<slots)&&(bits<14)) bits++;
+  mask=(1U<<bits)-1;
+  tab=new LoraPeer[mask+1];
+  clear();
+}
+
+void LoraPeers::clear()
+{
+  memset(tab,0,sizeof(LoraPeer)*(mask+1));
+  npeers=0;
+  stamp=0;
+  evict=0;
+}
+
+/* Fibonacci hashing: consecutive addresses are spread on the table */
+unsigned int LoraPeers::hash(unsigned int addr)
+{return ((uint16_t)(addr*40503U))>>(16-bits);}
+
+LoraPeer* LoraPeers::get(unsigned int addr)
+{
+  unsigned int h=hash(addr);
+  for (int i=0;i<peerMaxProbe;i++)
+  {
+    LoraPeer* p=&tab[(h+i)&mask];
+    if (p->addr==addr) {p->use=++stamp;return p;}
+    if (p->addr==0) return NULL;
+  }
+  return NULL;
+}
+
+/* A free (or removed) slot of the probe window is used, otherwise the least 
+   recently used record of the window is replaced */
+LoraPeer* LoraPeers::add(unsigned int addr)
+{
+  if ((addr==0)||(addr==peerDeleted)) return NULL;
+  LoraPeer* p=get(addr);
+  if (p!=NULL) return p;
+  unsigned int h=hash(addr);
+  LoraPeer* v=NULL;
+  bool fr=false;
+  for (int i=0;i<peerMaxProbe;i++)
+  {
+    p=&tab[(h+i)&mask];
+    if ((p->addr==0)||(p->addr==peerDeleted)) {v=p;fr=true;break;}
+    if ((v==NULL)||((long)(p->use-v->use)<0)) v=p;
+  }
+  if (fr) npeers++; else evict++;
+  memset(v,0,sizeof(LoraPeer));
+  v->addr=addr;
+  v->use=++stamp;
+  return v;
+}
+
+void LoraPeers::remove(unsigned int addr)
+{
+  LoraPeer* p=get(addr);
+  if (p==NULL) return;
+  p->addr=peerDeleted;
+  npeers--;
+}
+
+unsigned int LoraPeers::count(){return npeers;}
+unsigned int LoraPeers::size(){return mask+1;}
+
+LoraPeer* LoraPeers::slot(unsigned int i)
+{
+  if (i>mask) return NULL;
+  if ((tab[i].addr==0)||(tab[i].addr==peerDeleted)) return NULL;
+  return &tab[i];
+}
+
+unsigned long LoraPeers::getEvictions(){return evict;}
@@ -0,0 +1,90 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraPeers.
+*  Table of peer state (one fixed size record for every node heard), keyed by
+*  local address: link quality, frequency offset, application fields.
+*  Open addressing (linear probing) in a power of 2 slots array: lookup and 
+*  insert read at most peerMaxProbe consecutive records, whatever the number 
+*  of addresses of the network (up to 2^14).
+*  When probed records are all used, the least recently used one is replaced,
+*  so a small table keeps the peers in use (RAM-limited boards).
+*  Use: LoraPeers Peers(64); LR.setPeers(&Peers);  (or Node.setPeerTable())
+*/
+
+#ifndef LoraPeers_h
+#define LoraPeers_h
+
+#include <Arduino.h>
+
+#define defPeerSlots  32         //default table slots
+#define peerMaxProbe  8          //max records read by lookup/insert
+#define peerDeleted   0xFFFF     //removed record (out of local addresses range)
+
+struct LoraPeer
+{
+  unsigned int addr;             //local address (0: free slot)
+  unsigned long use;             //last use stamp (LRU)
+  unsigned long seen;            //last reception time (ms)
+  unsigned int rx;               //messages received
+  signed char rssi;              //last packet RSSI (dBm+100)
+  signed char snr;               //last packet SNR (dB)
+  byte pwr;                      //application fields (ex.: power and SF used
+  byte sf;                       // for the peer)
+  long ferr;                     //frequency offset (Hz) (LoraAfc)
+  int ftemp;                     //temperature of offset (LoraAfc)
+  byte fn;                       //offset measures (LoraAfc)
+  unsigned int seq;              //last sequence number received
+  unsigned long seqMap;          //sequence numbers received before seq (bitmap)
+  byte seqOk;                    //seq is valid
+  unsigned int tx;               //messages sent waiting acknowledge (LoraNode)
+  unsigned int txAck;            //  acknowledged or answered
+};
+
+class LoraPeers
+{
+  public:
+  
+/* Table of slots records (rounded to power of 2, min 8) */  
+  LoraPeers(unsigned int slots);
+  LoraPeers();
+  
+/* Record of peer addr, or NULL if not in table */  
+  LoraPeer* get(unsigned int addr);
+/* Record of peer addr; it is created (cleared) if not in table */  
+  LoraPeer* add(unsigned int addr);
+/* Remove peer addr */  
+  void remove(unsigned int addr);
+  void clear();
+  
+/* Number of peers in table and number of slots */  
+  unsigned int count();
+  unsigned int size();
+/* Record in slot i (0 to size-1), NULL if free (to scan all peers) */  
+  LoraPeer* slot(unsigned int i);
+/* Records replaced to make room (table too small if it grows fast) */  
+  unsigned long getEvictions();
+
+  private:
+  void init(unsigned int slots);
+  unsigned int hash(unsigned int addr);
+  
+  LoraPeer* tab;
+  unsigned int mask;
+  byte bits;
+  unsigned int npeers;
+  unsigned long stamp;           //LRU clock
+  unsigned long evict;
+};
+
+#endif
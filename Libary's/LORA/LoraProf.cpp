@@ -0,0 +1,80 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraProf.h"
+
+#ifdef LORA_PROFILE
+
+ProfProbe LoraProf::probe[profProbes];
+
+static const char* const profName[profProbes]=
+  {"aes_enc","aes_dec","sx_poll","spi","draw_str","i2c_flush","user0","user1"};
+
+void LoraProf::add(byte id,uint32_t ticks)
+{
+  ProfProbe &p=probe[id];
+  p.calls++;p.timed++;p.total+=ticks;
+  if (ticks>p.maxt) p.maxt=ticks;
+  byte b=0;
+  uint32_t v=ticks>>(profShift+1);
+  while ((v!=0)&&(b<profBuckets-1)) {v>>=1;b++;}
+  if (p.hist[b]!=0xFFFF) p.hist[b]++;
+}
+
+ProfProbe* LoraProf::get(byte id){return (id<profProbes)?&probe[id]:NULL;}
+
+void LoraProf::reset(){memset(probe,0,sizeof(probe));}
+
+static float profUs(uint64_t t){return (float)t*1000000.0/profTickHz;}
+
+void LoraProf::dump()
+{
+  Serial.print("Profile (bucket 0 < ");Serial.print(profUs(2UL<<profShift),3);Serial.println(" us, x2 each)");
+  for (byte i=0;i<profProbes;i++)
+  {
+    ProfProbe &p=probe[i];
+    if (p.calls==0) continue;
+    Serial.print(profName[i]);Serial.print(" calls ");Serial.print(p.calls);
+    if (p.timed>0)
+    {
+      Serial.print(" mean us ");Serial.print(profUs(p.total/p.timed),2);
+      Serial.print(" max us ");Serial.print(profUs(p.maxt),2);
+      Serial.print(" hist");
+      for (byte b=0;b<profBuckets;b++) {Serial.print(' ');Serial.print(p.hist[b]);}
+    }
+    Serial.println();
+  }
+}
+
+static byte* putLE(byte* b,uint64_t v,byte n){for (byte i=0;i<n;i++) {*b++=v&0xFF;v>>=8;}return b;}
+
+int LoraProf::exportStats(byte* buff,int len)
+{
+  int rec=1+4+4+4+8+2*profBuckets;
+  if (len<5+profProbes*rec) return 0;
+  byte* b=putLE(buff,profTickHz/1000000UL,4);
+  byte* nb=b++;
+  byte n=0;
+  for (byte i=0;i<profProbes;i++)
+  {
+    ProfProbe &p=probe[i];
+    if (p.calls==0) continue;
+    *b++=i;
+    b=putLE(b,p.calls,4);b=putLE(b,p.timed,4);b=putLE(b,p.maxt,4);b=putLE(b,p.total,8);
+    for (byte k=0;k<profBuckets;k++) b=putLE(b,p.hist[k],2);
+    n++;
+  }
+  *nb=n;
+  return b-buff;
+}
+
+#endif
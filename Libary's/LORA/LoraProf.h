@@ -0,0 +1,111 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* LoraProf : hot path profiling (compiled only with LORA_PROFILE defined,
+*  as build flag -DLORA_PROFILE or uncommenting the line below; otherwise
+*  probes are empty macros and no RAM is used).
+*  Probes in library code: AES buffer encrypt/decrypt, SX1278 flag register 
+*  polls and SPI transactions, OLEDDisplay::drawString and SSD1306Wire 
+*  display() (I2C flush). Two user probes (ProfUser0/1) for sketch code.
+*  PROF_SCOPE(id) times the enclosing block (cycle counter on ESP32/ESP8266,
+*  steady clock on host, micros() elsewhere); PROF_COUNT(id) counts a call.
+*  Every probe has calls, total, max and a log2 histogram of durations 
+*  (bucket b: ticks < 2^(b+profShift+1)); updates use no heap and no Serial.
+*  Stats: LoraProf::get(id), reset(), dump() (text on Serial, outside timed 
+*  code) and exportStats(buff,len) (compact binary).
+*/
+
+#ifndef LoraProf_h
+#define LoraProf_h
+
+#include <Arduino.h>
+
+//#define LORA_PROFILE
+
+#define ProfAesEnc      0        //probe ids
+#define ProfAesDec      1
+#define ProfSxPoll      2
+#define ProfSpi         3
+#define ProfDrawString  4
+#define ProfI2cFlush    5
+#define ProfUser0       6
+#define ProfUser1       7
+#define profProbes      8
+#define profBuckets     16       //histogram buckets
+#define profShift       4        //first bucket: ticks < 32
+
+#ifdef LORA_PROFILE
+
+#if defined(__XTENSA__)
+inline uint32_t profTicks() {uint32_t c;__asm__ __volatile__("rsr %0,ccount":"=a"(c));return c;}
+#define profTickHz F_CPU
+#elif defined(__linux__) || defined(_WIN32) || defined(__APPLE__)
+#include <chrono>
+inline uint32_t profTicks() 
+  {return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();}
+#define profTickHz 1000000000UL
+#else
+inline uint32_t profTicks() {return micros();}
+#define profTickHz 1000000UL
+#endif
+
+struct ProfProbe
+{
+  uint32_t calls;                //counted calls (timed or not)
+  uint32_t timed;                //timed calls
+  uint32_t maxt;                 //max duration (ticks)
+  uint64_t total;                //total duration (ticks)
+  uint16_t hist[profBuckets];    //durations (saturated counts)
+};
+
+class LoraProf
+{
+  public:
+  static void count(byte id) {probe[id].calls++;}
+  static void add(byte id,uint32_t ticks);
+/* Probe stats (NULL if id not valid) */  
+  static ProfProbe* get(byte id);
+  static void reset();
+/* Print table of probes with calls (us: mean, max, histogram) */  
+  static void dump();
+/* Binary stats in buff: [ticks/us 4][n] then for every probe 
+   [id][calls 4][timed 4][max 4][total 8][hist 2*profBuckets] (little 
+   endian). Return bytes written (0 if len too small) */  
+  static int exportStats(byte* buff,int len);
+  private:
+  static ProfProbe probe[profProbes];
+};
+
+class ProfTimer
+{
+  public:
+  ProfTimer(byte pid) {id=pid;t0=profTicks();}
+  ~ProfTimer() {LoraProf::add(id,profTicks()-t0);}
+  private:
+  byte id;
+  uint32_t t0;
+};
+
+#define PROF_CAT2(a,b) a##b
+#define PROF_CAT(a,b) PROF_CAT2(a,b)
+#define PROF_SCOPE(id) ProfTimer PROF_CAT(profTimer,__LINE__)(id)
+#define PROF_COUNT(id) LoraProf::count(id)
+
+#else
+
+#define PROF_SCOPE(id)
+#define PROF_COUNT(id)
+
+#endif
+
+#endif
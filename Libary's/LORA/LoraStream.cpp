@@ -0,0 +1,254 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraStream. Compression of periodic readings.
+*  Signed values (timestamp delta of delta, integer delta) are coded as:
+*   0                  : 0 
+*   10   + 7 bits      : -64 to 63
+*   110  + 9 bits      : -256 to 255
+*   1110 + 12 bits     : -2048 to 2047
+*   1111 + 32 bits     : any other
+*  Float XOR x with previous value is coded as:
+*   0                  : x=0
+*   10 + meaningful bits (previous window)
+*   11 + 5 bits leading zeros + 5 bits (length-1) + length meaningful bits
+*/
+
+#include "LoraStream.h"
+
+LoraStream::LoraStream(byte type)
+{
+  vtype=type;
+  keyint=defKeyInterval;
+  for (int i=0;i<maxStreamPeers;i++) {enc[i].peer=0;dec[i].peer=0;}
+  evict=0;
+  cur=NULL;
+}
+
+void LoraStream::setKeyInterval(byte n){if (n<1) n=1;keyint=n;}
+
+/* Find peer state or take a free (or the oldest) one */
+StreamPeer* LoraStream::getPeer(StreamPeer* tab,int peer)
+{
+  int i;
+  for (i=0;i<maxStreamPeers;i++) if (tab[i].peer==peer) return &tab[i];
+  for (i=0;i<maxStreamPeers;i++) if (tab[i].peer==0) break;
+  if (i>=maxStreamPeers) {i=evict;evict=(evict+1)%maxStreamPeers;}
+  tab[i].peer=peer;tab[i].seq=0;tab[i].nkey=0;tab[i].sync=false;
+  return &tab[i];
+}
+
+/**** Sending ****/
+
+void LoraStream::beginFrame(int peer,byte buff[],int maxlen)
+{
+  cur=getPeer(enc,peer);
+  buf=buff;
+  blen=maxlen*8;
+  bpos=16;
+  nread=0;
+  ovf=(maxlen<2);
+  if (ovf) return;
+  bool key=(!cur->sync)||(cur->nkey>=keyint);
+  if (key) {cur->nkey=0;cur->sync=true;cur->lead=255;}
+  first=key;
+  buf[0]=cur->seq|(key<<7);
+  cur->seq=(cur->seq+1)&0x7F;
+  cur->nkey++;
+}
+
+bool LoraStream::addInt(unsigned long ts,long v)
+{
+  if (vtype!=StreamInt) return false;
+  return add(ts,(uint32_t)v);
+}
+
+bool LoraStream::addFloat(unsigned long ts,float v)
+{
+  if (vtype!=StreamFloat) return false;
+  uint32_t b;memcpy(&b,&v,4);
+  return add(ts,b);
+}
+
+/* Add reading; if it doesn't fit, buffer and state are restored */
+bool LoraStream::add(uint32_t ts,uint32_t v)
+{
+  if ((cur==NULL)||ovf||(nread==255)) return false;
+  StreamPeer saved=*cur;
+  int spos=bpos;
+  bool sfirst=first;
+  if (first) {putBits(ts,32);putBits(v,32);cur->dts=0;first=false;}
+  else {putTs(ts);putVal(v);}
+  if (ovf) {*cur=saved;bpos=spos;first=sfirst;ovf=false;return false;}
+  cur->ts=ts;cur->val=v;
+  nread++;
+  return true;
+}
+
+int LoraStream::endFrame()
+{
+  if (cur==NULL) return 0;
+  if (ovf) {cur=NULL;return 0;}                //buffer shorter than header
+  buf[1]=nread;
+  cur=NULL;
+  return (bpos+7)/8;
+}
+
+void LoraStream::resync(int peer)
+{
+  for (int i=0;i<maxStreamPeers;i++) if (enc[i].peer==peer) enc[i].sync=false;
+}
+
+/**** Receiving ****/
+
+int LoraStream::beginDecode(int peer,byte buff[],int len)
+{
+  cur=NULL;
+  if (len<2) return -1;
+  StreamPeer* p=getPeer(dec,peer);
+  byte seq=buff[0]&0x7F;
+  bool key=buff[0]>>7;
+  if (key) {p->sync=true;p->lead=255;}
+  else if ((!p->sync)||(seq!=p->seq)) {p->sync=false;return -1;}
+  p->seq=(seq+1)&0x7F;
+  cur=p;
+  first=key;
+  buf=buff;
+  blen=len*8;
+  bpos=16;
+  nread=buff[1];
+  ovf=false;
+  return nread;
+}
+
+bool LoraStream::nextInt(unsigned long* ts,long* v)
+{
+  uint32_t t,b;
+  if ((vtype!=StreamInt)||!next(&t,&b)) return false;
+  *ts=t;*v=(int32_t)b;
+  return true;
+}
+
+bool LoraStream::nextFloat(unsigned long* ts,float* v)
+{
+  uint32_t t,b;
+  if ((vtype!=StreamFloat)||!next(&t,&b)) return false;
+  *ts=t;memcpy(v,&b,4);
+  return true;
+}
+
+bool LoraStream::next(uint32_t* ts,uint32_t* v)
+{
+  if ((cur==NULL)||(nread==0)) return false;
+  uint32_t t,b;
+  if (first) {t=getBits(32);b=getBits(32);cur->dts=0;first=false;}
+  else {t=getTs();b=getVal();}
+  if (ovf) {cur->sync=false;cur=NULL;return false;}
+  cur->ts=t;cur->val=b;
+  nread--;
+  *ts=t;*v=b;
+  return true;
+}
+
+/**** Coding ****/
+
+void LoraStream::putTs(uint32_t ts)
+{
+  long d=(long)(ts-cur->ts);
+  putSigned(d-cur->dts);
+  cur->dts=d;
+}
+
+uint32_t LoraStream::getTs()
+{
+  cur->dts+=getSigned();
+  return cur->ts+cur->dts;
+}
+
+void LoraStream::putVal(uint32_t v)
+{
+  if (vtype==StreamInt) {putSigned((long)(int32_t)(v-cur->val));return;}
+  uint32_t x=v^cur->val;
+  if (x==0) {putBits(0,1);return;}
+  byte lz=0;while (!(x&0x80000000UL>>lz)) lz++;
+  byte tz=0;while (!(x&1UL<<tz)) tz++;
+  if (lz>31) lz=31;
+  if ((cur->lead!=255)&&(lz>=cur->lead)&&(tz>=cur->trail))
+  {
+    putBits(2,2);
+    putBits(x>>cur->trail,32-cur->lead-cur->trail);
+    return;
+  }
+  byte len=32-lz-tz;
+  putBits(3,2);putBits(lz,5);putBits(len-1,5);
+  putBits(x>>tz,len);
+  cur->lead=lz;cur->trail=tz;
+}
+
+uint32_t LoraStream::getVal()
+{
+  if (vtype==StreamInt) return cur->val+(uint32_t)getSigned();
+  if (getBits(1)==0) return cur->val;
+  if (getBits(1)==0)
+  {
+    if (cur->lead==255) {ovf=true;return 0;}
+    return cur->val^(getBits(32-cur->lead-cur->trail)<<cur->trail);
+  }
+  byte lz=getBits(5);
+  byte len=getBits(5)+1;
+  if (lz+len>32) {ovf=true;return 0;}
+  cur->lead=lz;cur->trail=32-lz-len;
+  return cur->val^(getBits(len)<<cur->trail);
+}
+
+void LoraStream::putSigned(long v)
+{
+  if (v==0) putBits(0,1);
+  else if ((v>=-64)&&(v<64)) {putBits(2,2);putBits(v,7);}
+  else if ((v>=-256)&&(v<256)) {putBits(6,3);putBits(v,9);}
+  else if ((v>=-2048)&&(v<2048)) {putBits(14,4);putBits(v,12);}
+  else {putBits(15,4);putBits(v,32);}
+}
+
+long LoraStream::getSigned()
+{
+  byte n;
+  if (getBits(1)==0) return 0;
+  if (getBits(1)==0) n=7;
+  else if (getBits(1)==0) n=9;
+  else if (getBits(1)==0) n=12;
+  else return (int32_t)getBits(32);
+  uint32_t v=getBits(n);
+  if (v&(1UL<<(n-1))) v|=~((1UL<<n)-1);   //sign extension
+  return (int32_t)v;
+}
+
+/* Bit stream (MSB first) */
+void LoraStream::putBits(uint32_t v,byte n)
+{
+  if (bpos+n>blen) {ovf=true;return;}
+  while (n--)
+  {
+    byte m=0x80>>(bpos&7);
+    if ((v>>n)&1) buf[bpos>>3]|=m; else buf[bpos>>3]&=~m;
+    bpos++;
+  }
+}
+
+uint32_t LoraStream::getBits(byte n)
+{
+  if (bpos+n>blen) {ovf=true;return 0;}
+  uint32_t v=0;
+  while (n--) {v=(v<<1)|((buf[bpos>>3]>>(7-(bpos&7)))&1);bpos++;}
+  return v;
+}
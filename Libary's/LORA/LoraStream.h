@@ -0,0 +1,116 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraStream.
+*  Compression of periodic readings (timestamp, value) sent to (or received 
+*  from) other nodes, to put many readings in a single LoraNode message.
+*  Compression state is kept for each peer node:
+*  - timestamps are coded as delta of delta (0 if period is constant: 1 bit)
+*  - integer values are coded as delta from previous value
+*  - float values are coded as XOR with previous value (Gorilla style)
+*  Every frame has a sequence number. If a frame is lost receiver waits for 
+*  next keyframe (absolute values), sent every "key interval" frames or after
+*  resync() call (ex. when writeMessageByte() is not acknowledged).
+*  Frame format: seq(7 bits)+keyframe flag, number of readings, bit stream.
+*  Sender:
+*    St.beginFrame(peer,buff,maxlen); St.addInt(ts,val); ... len=St.endFrame();
+*    if (!Node.writeMessageByte(peer,buff,len,500)) St.resync(peer);
+*  Receiver:
+*    n=St.beginDecode(peer,buff,len); (-1 if frame can't be decoded)
+*    while (St.nextInt(&ts,&val)) {...}  (all readings must be read) 
+*/
+
+#ifndef LoraStream_h
+#define LoraStream_h
+
+#include <Arduino.h>
+
+#define StreamInt   0            //integer values (long)
+#define StreamFloat 1            //float values
+
+#define maxStreamPeers 8         //peers with compression state (each way)
+#define defKeyInterval 16        //frames between keyframes
+
+struct StreamPeer
+{
+  int peer;                      //node address (0: free)
+  byte seq;                      //next (sender) or expected (receiver) sequence
+  byte nkey;                     //frames from last keyframe
+  bool sync;                     //state valid (false: keyframe needed)
+  uint32_t ts;                   //last timestamp
+  long dts;                      //last timestamp delta
+  uint32_t val;                  //last value (long or float bits)
+  byte lead;                     //XOR window of last float (lead 255: none)
+  byte trail;
+};
+
+class LoraStream
+{
+  public:
+  
+/* Stream of values of type StreamInt or StreamFloat */  
+  LoraStream(byte type);
+  
+/* Set frames between keyframes (def. 16) */  
+  void setKeyInterval(byte n);
+  
+/**** Sending ****/
+
+/* Start a frame for peer node into buff (max maxlen bytes) */
+  void beginFrame(int peer,byte buff[],int maxlen);
+/* Add reading. It returns false if frame is full (reading not added) */  
+  bool addInt(unsigned long ts,long v);
+  bool addFloat(unsigned long ts,float v);
+/* End frame. It returns frame length (0 if maxlen<2: no frame) */  
+  int endFrame();
+/* Next frame for peer will be a keyframe */  
+  void resync(int peer);
+
+/**** Receiving ****/
+
+/* Start decoding a frame from peer. It returns number of readings or -1 
+   if frame can't be decoded (lost frame: waiting for keyframe) */
+  int beginDecode(int peer,byte buff[],int len);
+/* Get next reading. It returns false if no more readings */  
+  bool nextInt(unsigned long* ts,long* v);
+  bool nextFloat(unsigned long* ts,float* v);
+  
+  private:
+  StreamPeer* getPeer(StreamPeer* tab,int peer);
+  bool add(uint32_t ts,uint32_t v);
+  bool next(uint32_t* ts,uint32_t* v);
+  void putTs(uint32_t ts);
+  void putVal(uint32_t v);
+  uint32_t getTs();
+  uint32_t getVal();
+  void putSigned(long v);
+  long getSigned();
+  void putBits(uint32_t v,byte n);
+  uint32_t getBits(byte n);
+  
+  byte vtype;
+  byte keyint;
+  StreamPeer enc[maxStreamPeers];
+  StreamPeer dec[maxStreamPeers];
+  byte evict;
+  
+  StreamPeer* cur;               //peer of current frame
+  bool first;                    //next reading is the first of a keyframe
+  byte* buf;
+  int blen;                      //buffer length (bits)
+  int bpos;                      //bit position
+  byte nread;                    //readings in frame
+  bool ovf;                      //buffer overflow
+};
+
+#endif
@@ -0,0 +1,31 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraTrace.h"
+
+LoraTrace* LoraTrace::active=NULL;
+
+LoraTrace::LoraTrace(unsigned int len):TraceRing(len){}
+LoraTrace::LoraTrace():TraceRing(defEvents){}
+
+void LoraTrace::start(){active=this;}
+void LoraTrace::stop(){if (active==this) active=NULL;}
+
+void IRAM_ATTR LoraTrace::record(byte ev,byte arg,unsigned int val){add(ev,arg,val);}
+
+void LoraTrace::dump()
+{
+  bool was=(active==this);
+  stop();
+  print("ET");
+  if (was) start();
+}
@@ -0,0 +1,80 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraTrace.
+*  Timeline of radio and protocol events for latency diagnosis: radio state 
+*  changes (SX.setState), IRQ flags seen (and cleared), frames sent (TxDone
+*  time), frames read, CAD, acknowledges, LoraNode queue and retries, plus 
+*  application events. Every event is a compact 8 bytes record (time us, 
+*  event, argument, 16 bits value) in a fixed ring buffer (oldest 
+*  overwritten). Library events are recorded by the main program (LoraHop 
+*  interrupt routine only sets a flag); a slot is reserved by an atomic 
+*  increment, so an application interrupt routine can record events too.
+*  Recording costs a micros() read and four stores; with no trace started it 
+*  costs a pointer test. Buffer and dump ("ET:" lines, 16 hex digits 
+*  tttttttteeaavvvv per event) are TraceRing ones.
+*  extras/LoraSim/TraceTimeline.cpp decodes a dump into a timeline.
+*  Use: LoraTrace ET(256); ET.start(); ... ET.dump();
+*/
+
+#ifndef LoraTrace_h
+#define LoraTrace_h
+
+#include <Arduino.h>
+#include "TraceRing.h"
+
+#define EvState     1            //radio state set (arg: state)
+#define EvIrq       2            //IRQ flags changed (arg: RegIrqFlags)
+#define EvIrqClear  3            //IRQ flags cleared (arg: flags cleared)
+#define EvTx        4            //frame transmission start (val: bytes)
+#define EvTxDone    5            //TxDone (val: ms from EvTx)
+#define EvTxFail    6            //TxDone not seen (val: ms from EvTx)
+#define EvRx        7            //frame read (val: bytes; arg: 1 CRC error)
+#define EvCad       8            //LoraNode CAD (arg: 1 free, 0 busy)
+#define EvAckWait   9            //waiting acknowledge (val: node)
+#define EvAckOk     10           //acknowledge received (val: node)
+#define EvAckTout   11           //acknowledge timeout (val: node)
+#define EvQueue     12           //message queued (arg: port; val: queue bytes)
+#define EvFlush     13           //queue flushed (val: frames sent)
+#define EvRetry     14           //message sent again to a node (val: node)
+#define EvUser      15           //application events (EvUser and up)
+#define defEvents   128          //default events in buffer
+
+typedef TraceRecord TraceEvent; //t, ev, arg, val
+
+class LoraTrace : public TraceRing
+{
+  public:
+  
+/* Ring buffer of len events (rounded to power of 2) */  
+  LoraTrace(unsigned int len);
+  LoraTrace();
+  
+/* Start: library events go to this trace (one trace at a time); stop.
+   count(), getLost(), get(i), clear(): see TraceRing */  
+  void start();
+  void stop();
+/* Add event (also application events, ev>=EvUser; val max 65535) */  
+  void IRAM_ATTR record(byte ev,byte arg,unsigned int val);
+/* Print buffer on Serial (see format) and clear it */  
+  void dump();
+  
+/* Trace started (NULL if none) */  
+  static LoraTrace* active;
+};
+
+/* Library event: recorded if a trace is started */
+inline void traceEvent(byte ev,byte arg,unsigned int val)
+{if (LoraTrace::active!=NULL) LoraTrace::active->record(ev,arg,val);}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "LoraWatch.h"
+
+LoraWatch* LoraWatch::active=NULL;
+
+static const char* const watchNames[watchPoints]={"loop","waitForMess",
+  "CADmonitor","sendMess","waitAck","nodeSend","nodeRx","request",
+  "flushQueue","display","user0","user1"};
+
+LoraWatch::LoraWatch(unsigned long budgetUs){setBudget(budgetUs);alarm=NULL;reset();}
+LoraWatch::LoraWatch(){setBudget(defBudget);alarm=NULL;reset();}
+
+void LoraWatch::start(){loopT=micros();loopWorstUs=0;active=this;}
+void LoraWatch::stop(){if (active==this) active=NULL;}
+
+void LoraWatch::setBudget(unsigned long us)
+{for (byte i=0;i<watchPoints;i++) budget[i]=us;}
+
+void LoraWatch::setBudget(byte point,unsigned long us)
+{if (point<watchPoints) budget[point]=us;}
+
+unsigned long LoraWatch::getBudget(byte point)
+{return (point<watchPoints)?budget[point]:0;}
+
+void LoraWatch::setAlarm(void (*f)(byte point,unsigned long us)){alarm=f;}
+
+void LoraWatch::reset()
+{
+  memset(st,0,sizeof(st));
+  loopWorst=WatchLoop;loopWorstUs=0;
+}
+
+void LoraWatch::loop()
+{
+  unsigned long t=micros();
+  unsigned long us=t-loopT;
+  if ((us>budget[WatchLoop])&&(loopWorstUs>0)) st[loopWorst].culprit++;
+  check(WatchLoop,us);
+  loopT=micros();                //alarm time not counted
+  loopWorstUs=0;
+}
+
+void LoraWatch::check(byte point,unsigned long us)
+{
+  if (point>=watchPoints) return;
+  WatchStat* s=&st[point];
+  s->calls++;
+  if (us>s->maxUs) s->maxUs=us;
+  if ((point!=WatchLoop)&&(us>loopWorstUs)) {loopWorstUs=us;loopWorst=point;}
+  if (us<=budget[point]) return;
+  s->over++;
+  s->excess+=us-budget[point];
+  s->lastOver=millis();
+  if (alarm!=NULL) alarm(point,us);
+}
+
+WatchStat* LoraWatch::get(byte point){return (point<watchPoints)?&st[point]:NULL;}
+
+byte LoraWatch::worst()
+{
+  byte w=WatchLoop;
+  for (byte i=1;i<watchPoints;i++) if (st[i].excess>st[w].excess) w=i;
+  return w;
+}
+
+const char* LoraWatch::name(byte point){return (point<watchPoints)?watchNames[point]:"?";}
+
+void LoraWatch::dump()
+{
+  Serial.println("LW: point calls over max_us excess_ms last_s culprit (budget us)");
+  for (byte i=0;i<watchPoints;i++)
+  {
+    WatchStat* s=&st[i];
+    if (s->calls==0) continue;
+    Serial.print("LW: ");Serial.print(watchNames[i]);
+    Serial.print(" ");Serial.print(s->calls);
+    Serial.print(" ");Serial.print(s->over);
+    Serial.print(" ");Serial.print(s->maxUs);
+    Serial.print(" ");Serial.print((unsigned long)(s->excess/1000));
+    Serial.print(" ");Serial.print(s->over?s->lastOver/1000:0);
+    Serial.print(" ");Serial.print(s->culprit);
+    Serial.print(" (");Serial.print(budget[i]);Serial.println(")");
+  }
+  Serial.print("LW: worst ");Serial.println(watchNames[worst()]);
+}
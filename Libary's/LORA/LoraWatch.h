@@ -0,0 +1,117 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class LoraWatch.
+*  Loop latency monitor: blocking library calls (waitForMess, CADmonitor, 
+*  sendMess, waitAck, LoraNode send/receive/request/flushQueue, OLED display 
+*  flush) are marked by begin/end scopes; a call longer than its budget is an
+*  overrun, recorded per watch point (count, worst time, total excess, last 
+*  overrun time). Calling loop() at start of sketch loop() also measures the
+*  loop period: a long loop is attributed to the longest marked call inside
+*  it (culprit). An alarm function can be called on every overrun.
+*  Opt-in: nothing measured unless a monitor is started (then a micros() 
+*  read at begin and end of calls); with no monitor a pointer test.
+*  Nested calls are measured separately (sendFrame includes sendMess).
+*  Use: LoraWatch LW(20000); LW.start(); ... loop(){LW.loop(); ...}
+*       LW.dump() prints the offenders table on Serial.
+*  Sketch code: { WATCH_SCOPE(WatchUser0); delay(2000); }
+*/
+
+#ifndef LoraWatch_h
+#define LoraWatch_h
+
+#include <Arduino.h>
+
+#define WatchLoop        0       //sketch loop period (LoraWatch::loop())
+#define WatchWaitForMess 1       //LORA::waitForMess
+#define WatchCadMonitor  2       //LORA::CADmonitor
+#define WatchSendMess    3       //LORA::sendMess (duty wait, tx)
+#define WatchWaitAck     4       //LORA::waitAck
+#define WatchNodeSend    5       //LoraNode writeMessage, sendFrame
+#define WatchNodeRx      6       //LoraNode newMessAvailable
+#define WatchRequest     7       //LoraNode request
+#define WatchFlush       8       //LoraNode flushQueue
+#define WatchDisplay     9       //OLED display flush
+#define WatchUser0       10      //application calls
+#define WatchUser1       11
+#define watchPoints      12
+#define defBudget        50000   //default budget (us)
+
+struct WatchStat
+{
+  unsigned long calls;
+  unsigned long over;            //overruns
+  unsigned long maxUs;           //worst time
+  unsigned long lastOver;        //last overrun (millis)
+  unsigned long culprit;         //loop overruns caused by this point
+  unsigned long long excess;     //total time over budget (us)
+};
+
+class LoraWatch
+{
+  public:
+
+/* Monitor with budget (us) for all points */
+  LoraWatch(unsigned long budgetUs);
+  LoraWatch();
+
+/* Start: library calls are measured by this monitor (one at a time); stop */
+  void start();
+  void stop();
+/* Budget (us) of all points or of a point */
+  void setBudget(unsigned long us);
+  void setBudget(byte point,unsigned long us);
+  unsigned long getBudget(byte point);
+/* Function called on every overrun (point, time us) */
+  void setAlarm(void (*f)(byte point,unsigned long us));
+
+/* Mark start of sketch loop */
+  void loop();
+/* End of a marked call (point, time us) */
+  void check(byte point,unsigned long us);
+  
+/* Stats of point (NULL if invalid); point with largest total excess */
+  WatchStat* get(byte point);
+  byte worst();
+  const char* name(byte point);
+  void reset();
+/* Print offenders table on Serial */
+  void dump();
+
+/* Monitor started (NULL if none) */
+  static LoraWatch* active;
+
+  private:
+  WatchStat st[watchPoints];
+  unsigned long budget[watchPoints];
+  void (*alarm)(byte point,unsigned long us);
+  unsigned long loopT;           //loop start (us)
+  byte loopWorst;                //longest call in this loop
+  unsigned long loopWorstUs;
+};
+
+/* Begin/end marker of a call (measured if a monitor is started) */
+class WatchScope
+{
+  public:
+  WatchScope(byte point):p(point),on(LoraWatch::active!=NULL),t(on?micros():0){}
+  ~WatchScope(){if (on&&(LoraWatch::active!=NULL)) LoraWatch::active->check(p,micros()-t);}
+  private:
+  byte p;
+  bool on;
+  unsigned long t;
+};
+
+#define WATCH_SCOPE(point) WatchScope watchScope_(point)
+
+#endif
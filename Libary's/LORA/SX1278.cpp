@@ -30,8 +30,11 @@
 */
 
 #include <SX1278.h>
+#include <LoraProf.h>
+#include <LoraTrace.h>
 //#include <AES.h>
 static const float lorabwf[10]={7.8,10.4,15.6,20.8,31.25,41.7,62.5,125,250,500};
+static const unsigned long lorabwhz[10]={7800,10400,15600,20800,31250,41700,62500,125000,250000,500000};
 /******************************** General ************************************/
 
 /* Initialize SPI and reset SX1278. 
@@ -53,6 +56,46 @@ bool SX1278::begin()
   return true;
 }
 
+/* Initialize SPI only: registers set before MCU deep sleep are kept */
+bool SX1278::beginWarm()
+{
+  digitalWrite(SX1278Reset,1);
+  pinMode(SX1278Reset,OUTPUT);
+  initBus();
+  return SPIread(RegVersion)!=0;
+}
+
+/* Configuration registers read in 3 bursts (LoRa mode): mask of signature 
+   bits (state, symbol timeout, payload length, FIFO pointers excluded) */
+static const byte sigBurst[3][2]={{RegOpMode,12},{0x1D,10},{0x39,9}};
+
+static byte sigMask(byte a)
+{
+  if (a==RegOpMode) return 0xF8;
+  if (a==0x1E) return 0xFC;
+  if ((a==0x1F)||((a>=0x22)&&(a<=0x25))||((a>0x39)&&(a<0x40))) return 0;
+  return 0xFF;
+}
+
+unsigned int SX1278::configSignature()
+{
+  byte b[12];
+  unsigned int crc=0xFFFF;
+  for (byte i=0;i<3;i++)
+  {
+    SPIreadBurst(sigBurst[i][0],b,sigBurst[i][1]);
+    for (byte k=0;k<sigBurst[i][1];k++)
+    {
+      byte m=sigMask(sigBurst[i][0]+k);
+      if (m==0) continue;
+      crc^=(unsigned int)(b[k]&m)<<8;
+      for (byte j=0;j<8;j++) crc=(crc&0x8000)?(crc<<1)^0x1021:crc<<1;
+      crc&=0xFFFF;
+    }
+  }
+  return crc;
+}
+
 /* Reset */
 void SX1278::restart()
 {
@@ -71,6 +114,7 @@ void SX1278::setState(byte opstate)
   byte b=SPIread(RegOpMode);
   b=setBit(b,opstate,0,3);
   SPIwrite(RegOpMode,b);
+  traceEvent(EvState,opstate,0);
 }
 
 int SX1278::readState()
@@ -104,30 +148,78 @@ int SX1278::readMode()
   return bitRead(b,7);
 }
 
+void SX1278::getContext(SXContext &c)
+{
+  byte b[ctxRegs+1];
+  SPIreadBurst(RegOpMode,b,ctxRegs+1);
+  c.opmode=b[0];
+  memcpy(c.reg,b+1,ctxRegs);
+  SPIreadBurst(0x40,c.dio,2);
+}
+
+/* Mode bit (LoRa/FSK) can be changed only in SLEEP. IRQ flags (0x3E-0x3F 
+   in FSK) are not written; read only registers ignore the writes */
+void SX1278::setContext(const SXContext &c)
+{
+  setState(SLEEP);
+  SPIwrite(RegOpMode,c.opmode&0xF8);
+  SPIwriteBurst(RegOpMode+1,c.reg,ctxRegs);
+  SPIwriteBurst(0x40,c.dio,2);
+  SPIwrite(RegOpMode,(c.opmode&0xF8)|STDBY);
+  traceEvent(EvState,STDBY,0);
+}
+
 /* Set frequence in Mhz (SX12878 : 137-525 Mhz) (ex.: 433.92) (def.: 434.0)*/
-void SX1278::setFreq(float freq) 
+void SX1278::setFreq(float freq) {setFreqHz((unsigned long)(freq*1000000.0+0.5));}
+
+float SX1278::readFreq(){return (float)readFreqHz()/1000000;}
+
+void SX1278::setFreqHz(unsigned long hz) {setChannel(makeChannel(hz));}
+
+unsigned long SX1278::readFreqHz()
 {
-  union Bfreq
-  {
-    unsigned long ifreq;
-    unsigned char vfreq[4];
-  } bf;
-  bf.ifreq=(freq*1000000)/61.035;
-  SPIwrite(RegFrfMsb,bf.vfreq[2]); 
-  SPIwrite(RegFrfMid,bf.vfreq[1]); 
-  SPIwrite(RegFrfLsb,bf.vfreq[0]); 
+  byte f[3];
+  SPIreadBurst(RegFrfMsb,f,3);
+  unsigned long frf=f[0];frf=(frf<<8)+f[1];frf=(frf<<8)+f[2];
+  return frfToHz(frf-corrFrf);
+}
+
+SXChannel SX1278::makeChannel(unsigned long hz)
+{
+  SXChannel ch;
+  unsigned long frf=hzToFrf(hz);
+  ch.frf[0]=(frf>>16)&0xFF;ch.frf[1]=(frf>>8)&0xFF;ch.frf[2]=frf&0xFF;
+  return ch;
+}
+
+void SX1278::setChannel(const SXChannel &ch) 
+{
+  if (corrFrf==0) {SPIwriteBurst(RegFrfMsb,ch.frf,3);return;}
+  unsigned long frf=ch.frf[0];frf=(frf<<8)+ch.frf[1];frf=(frf<<8)+ch.frf[2];
+  frf+=corrFrf;
+  byte f[3]={(byte)(frf>>16),(byte)(frf>>8),(byte)frf};
+  SPIwriteBurst(RegFrfMsb,f,3);
 }
 
-float SX1278::readFreq()
+/* Correction is kept in Frf units too, so setChannel just adds it */
+void SX1278::setFreqCorr(long hz)
 {
-  unsigned char f0=SPIread(RegFrfLsb);
-  unsigned char f1=SPIread(RegFrfMid);
-  unsigned char f2=SPIread(RegFrfMsb);
-  unsigned long lfreq=f2;lfreq=(lfreq<<8)+f1;lfreq=(lfreq<<8)+f0;
-  float freq=((float)lfreq*61.035)/1000000;
-  return freq;
+  if (hz==corrHz) return;
+  unsigned long nom=readFreqHz();
+  corrHz=hz;
+  if (hz>=0) corrFrf=hzToFrf(hz); else corrFrf=-(long)hzToFrf(-hz);
+  setFreqHz(nom);
 }
 
+long SX1278::getFreqCorr(){return corrHz;}
+
+/* Frf = Hz*2^19/32MHz = Hz*256/15625, split to avoid 32 bits overflow (rounded) */
+unsigned long SX1278::hzToFrf(unsigned long hz)
+{return (hz/15625)*256+((hz%15625)*256+7812)/15625;}
+
+unsigned long SX1278::frfToHz(unsigned long frf)
+{return (frf>>8)*15625+(((frf&0xFF)*15625+128)>>8);}
+
 /* Set/get transmit power; pw can be:
 *   1 (7dBm=5mW), 2 (10dBm=10mW), 3 (13dBm=20mW), 4 (17dBm=50mW)(def.), 5 (20dBm=100mW)
 *   NB. It uses pin PA_BOOST because is the only possibility with lora module
@@ -230,6 +322,24 @@ void SX1278::tempCalib()
   setState(STDBY);
 }
 
+int SX1278::readTempLora()
+{
+  setState(SLEEP);
+  startModeFSKOOK();
+  setState(FSRX);
+  byte b=SPIread(0x3b);
+  bitClear(b,0);
+  SPIwrite(0x3b,b);
+  delayMicroseconds(150);
+  bitSet(b,0);
+  SPIwrite(0x3b,b);
+  setState(SLEEP);
+  int t=readTemp();
+  startModeLORA();
+  setState(STDBY);
+  return t;
+}
+
 /***************************** FSK/OOK mode **********************************/
 
 /* When in standard way, this function decides if FSK or OOK modulation */
@@ -247,7 +357,7 @@ int SX1278::readModulation()
 }
 
 /* Set bit rate (BPS) (mode FSKOOK) (def.: 4800)*/
-void SX1278::setBPS(int bps)
+void SX1278::setBPS(unsigned long bps)
 {
   unsigned long lrate=32000000/bps;
   unsigned int rate=lrate;
@@ -265,6 +375,30 @@ unsigned int SX1278::readBPS()
   return bps;
 }
 
+/* Fstep 61.035 Hz (32 MHz / 2^19) */
+void SX1278::setFdev(unsigned long hz)
+{
+  unsigned int f=(hz*64+1953)/3906;
+  if (f>0x3FFF) f=0x3FFF;
+  byte b[2]={highByte(f),lowByte(f)};
+  SPIwriteBurst(0x04,b,2);
+}
+
+/* Bandwidth = 32 MHz / (mant * 2^(exp+2)), mant 16,20,24 (code 0,1,2), exp 1-7 */
+static byte rxBwCode(unsigned long hz)
+{
+  for (byte e=7;e>=1;e--)
+    for (byte m=2;m<=2;m--)
+      if (32000000UL/((16UL+4*m)<<(e+2))>=hz) return (m<<3)|e;
+  return 1;
+}
+
+void SX1278::setRxBw(unsigned long hz,unsigned long afcHz)
+{
+  byte b[2]={rxBwCode(hz),rxBwCode(afcHz)};
+  SPIwriteBurst(0x12,b,2);
+}
+
 /* Set/reset Packet mode */   
 void SX1278::setPackNoPack(byte yesno)
 {
@@ -332,8 +466,7 @@ void SX1278::setPacket(byte variable,byte crc,byte len)
 /* Load FIFO with data to transmit (mode FSKOOK)*/
 void SX1278::dataToSend(byte data[],int len)
 {
-  int i;
-  for (i=0;i<len;i++) { SPIwrite(0x0,data[i]);}
+  while (len>0) {byte n=(len>255)?255:len;SPIwriteBurst(RegFifo,data,n);data+=n;len-=n;}
 }
 
 /* Get register flags 1 or 2 */
@@ -468,16 +601,28 @@ void SX1278::preambleDetect(byte yesno)
 */
 bool SX1278::getLoraFlag(byte flag)
 {
+  PROF_COUNT(ProfSxPoll);
   byte b=SPIread(0x12);
+  traceIrq(b);
   return bitRead(b,flag);
 }
 
+/* Event trace: IRQ flags recorded when they change */
+void SX1278::traceIrq(byte b)
+{
+  if ((LoraTrace::active==NULL)||(b==irqSeen)) return;
+  irqSeen=b;
+  LoraTrace::active->record(EvIrq,b,0);
+}
+
 /* reset LORA flag */
 void SX1278::clearLoraFlag(byte flag)
 {
   byte b=SPIread(0x12);
   byte mask=0; bitSet(mask,flag);
   SPIwrite(0x12,b&mask);
+  irqSeen&=~mask;
+  traceEvent(EvIrqClear,mask,0);
 }
 
 /* reset all LORA flags */
@@ -486,13 +631,17 @@ void SX1278::clearAllLoraFlag()
   byte b=SPIread(0x12);
   b=b&0xFF;
   SPIwrite(0x12,b);
+  irqSeen=0;
+  traceEvent(EvIrqClear,b,0);
 }
 
 /* get LORA flags for timeout or rx done 
    It returns 0 if nothing, 1 if packet received, -1 if timeout */
 int SX1278::getLoraRxEndFlag()
 {
+  PROF_COUNT(ProfSxPoll);
   byte b=SPIread(0x12);
+  traceIrq(b);
   if (bitRead(b,6)) return 1; 
   if (bitRead(b,7)) return -1;
   return 0;
@@ -517,6 +666,8 @@ void SX1278::setLoraSprFactor(byte spf)
   if (spf>12) spf=12;
   b=setBit(b,spf,4,4);
   SPIwrite(0x1E,b);
+  setRegBits(0x31,(spf==6)?0x05:0x03,0,3);  //detection optimize
+  SPIwrite(0x37,(spf==6)?0x0C:0x0A);        //detection threshold
 }
 
 byte SX1278::getLoraSprFactor()
@@ -587,6 +738,71 @@ float SX1278::getLorabps()
    return sf*crate*srate;
 }
 
+/* Time on air (microseconds) of a packet of plen payload bytes.
+   Formula of SX1276/77/78 datasheet (par. 4.1.1.7) */
+unsigned long SX1278::getLoraTimeOnAir(byte plen)
+{
+  byte b1=SPIread(0x1D);
+  byte b2=SPIread(0x1E);
+  int sf=getBit(b2,4,4);
+  int cr=getBit(b1,1,3);
+  int ih=bitRead(b1,0);
+  int crc=bitRead(b2,2);
+  int de=getRegBit(0x26,3);
+  byte bw=getBit(b1,4,4); if (bw>9) bw=9;
+  unsigned long tsym=(1UL<<sf)*1000000UL/lorabwhz[bw];
+  long num=8L*plen-4*sf+28+16*crc-20*ih;
+  long den=4*(sf-2*de);
+  long nsym=8;
+  if (num>0) nsym+=((num+den-1)/den)*(cr+4);
+  unsigned long tpre=(getLoraPreambleLen()*4UL+17)*tsym/4;
+  return tpre+nsym*tsym;
+}
+
+void SX1278::setLoraImplicitHeader(boolean on,byte len)
+{
+  setRegBit(0x1D,0,on);
+  if (on) SPIwrite(0x22,len);
+}
+
+boolean SX1278::getLoraImplicitHeader(){return getRegBit(0x1D,0);}
+
+void SX1278::getLoraFrameCfg(SXFrameCfg &c)
+{
+  byte b[2];
+  SPIreadBurst(0x1D,b,2);
+  c.mc1=b[0];c.mc2=b[1];
+  c.plen=SPIread(0x22);
+  c.mc3=SPIread(0x26);
+  c.detopt=SPIread(0x31);
+  c.detthr=SPIread(0x37);
+}
+
+void SX1278::setLoraFrameCfg(const SXFrameCfg &c)
+{
+  byte b[2]={c.mc1,c.mc2};
+  SPIwriteBurst(0x1D,b,2);
+  SPIwrite(0x22,c.plen);
+  SPIwrite(0x26,c.mc3);
+  SPIwrite(0x31,c.detopt);
+  SPIwrite(0x37,c.detthr);
+}
+
+/* LDRO is on if symbol time is over 16 ms */
+SXFrameCfg SX1278::implicitCfg(const SXFrameCfg &c,byte len,byte sf)
+{
+  SXFrameCfg i=c;
+  bitSet(i.mc1,0);
+  i.plen=len;
+  if ((sf<6)||(sf>12)) return i;
+  i.mc2=(i.mc2&0x0F)|(sf<<4);
+  byte bw=i.mc1>>4; if (bw>9) bw=9;
+  bitWrite(i.mc3,3,((1UL<<sf)*1000UL/lorabwhz[bw])>16);
+  i.detopt=(i.detopt&0xF8)|((sf==6)?0x05:0x03);
+  i.detthr=(sf==6)?0x0C:0x0A;
+  return i;
+}
+
 /* Set on in case of simbol rate < 62/sec (or bps < 1200) */
 void SX1278::setLoraLowDataRateOptimize(boolean on)
 {  
@@ -685,6 +901,16 @@ int SX1278::lastLoraPacketSnr()        //dBm
   return isnr;
 }
 
+/* FreqError (20 bits signed) * 2^24/Fxtal * BW/500kHz */
+long SX1278::lastLoraPacketFreqErr()
+{
+  byte f[3];
+  SPIreadBurst(0x28,f,3);
+  long fe=f[0]&0x0F;fe=(fe<<8)+f[1];fe=(fe<<8)+f[2];
+  if (fe&0x80000) fe-=0x100000;
+  return (long)((float)fe*0.524288*getLoraBwFreq()/500);
+}
+
 int SX1278::getLoraRssi()              //dBm
 {
   return -164+SPIread(0x1B);
@@ -739,23 +965,54 @@ unsigned int SX1278::setRndSeed()
 int SX1278::SPIwrite(byte address,byte val)
 {
 
+  PROF_COUNT(ProfSpi);
   digitalWrite(ss,0);
   SPI.transfer(address | 0x80);
   delayMicroseconds(100);
   SPI.transfer(val);
   digitalWrite(ss,1); 
+  BUS_TRACE(trace,BusSPI,address,2);
+  return 0;
+}
+
+void SX1278::SPIwriteBurst(byte address,const byte val[],byte n)
+{
+  PROF_COUNT(ProfSpi);
+  digitalWrite(ss,0);
+  SPI.transfer(address | 0x80);
+  delayMicroseconds(100);
+  for (int i=0;i<n;i++) SPI.transfer(val[i]);
+  digitalWrite(ss,1); 
+  BUS_TRACE(trace,BusSPI,address,n+1);
+}
+
+void SX1278::SPIreadBurst(byte address,byte val[],byte n)
+{
+  PROF_COUNT(ProfSpi);
+  digitalWrite(ss,0);
+  SPI.transfer(address);
+  delayMicroseconds(100);
+  for (int i=0;i<n;i++) val[i]=SPI.transfer(0x00);
+  digitalWrite(ss,1); 
+  BUS_TRACE(trace,BusSPI|TraceRead,address,n+1);
 }
 
 int SX1278::SPIread(byte address)
 {
+  PROF_COUNT(ProfSpi);
   digitalWrite(ss,0);
   SPI.transfer(address);
   delayMicroseconds(100);
   int val=SPI.transfer(0x00);
   digitalWrite(ss,1); 
+  BUS_TRACE(trace,BusSPI|TraceRead,address,2);
   return val;
 }
 
+#ifdef LORA_BUSTRACE
+void SX1278::setTrace(BusTrace* t){trace=t;}
+#endif
+
 /* get and set single bit of register */
 void SX1278::setRegBit(byte reg,byte n,byte onoff)
 {
@@ -807,6 +1064,15 @@ void SX1278::setBoost(byte yesno)
 }
 
 bool SX1278::initSPI()
+{
+  initBus();
+  digitalWrite(SX1278Reset,0);
+  delay(1);
+  digitalWrite(SX1278Reset,1);
+  return true;
+}
+
+void SX1278::initBus()
 {
   digitalWrite(ss,1);
   pinMode(ss,OUTPUT);  
@@ -814,13 +1080,8 @@ bool SX1278::initSPI()
   SPI.setDataMode(SPI_MODE0);
   SPI.setBitOrder(MSBFIRST); 
 //  SPI.setClockDivider(SPI_CLOCK_DIV16);
-  digitalWrite(SX1278Reset,0);
-  delay(1);
-  digitalWrite(SX1278Reset,1);
 }
 
-
-
 byte SX1278::setBit(byte b,byte val,byte bst, byte len)
 {
   int i;
@@ -36,6 +36,7 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include <BusTrace.h>
 #include <AES.h>
 
 #define SX1278Reset 9 
@@ -66,6 +67,9 @@
 #define RegFrfMid      0x07
 #define RegFrfLsb      0x08
 
+#define RegHopChannel  0x1C
+#define RegHopPeriod   0x24
+
 #define RegVersion     0x42
 
 /* Radio mode values */
@@ -97,6 +101,22 @@
 
 /***/
 
+/* Channel: Frf registers (Msb,Mid,Lsb) precomputed by SX.makeChannel(Hz), 
+   so changing channel is a single burst write */
+struct SXChannel {byte frf[3];};
+
+/* LoRa frame configuration: modem config 1,2 (header mode, BW, CR, SF, CRC),
+   payload length (implicit header), modem config 3 (LDRO), detection optimize
+   and threshold (SF6). Switching configuration is a few register writes */
+struct SXFrameCfg {byte mc1; byte mc2; byte plen; byte mc3; byte detopt; byte detthr;};
+
+/* Radio context: snapshot of a mode configuration (LoRa or FSK/OOK), i.e. 
+   RegOpMode, registers 0x02-0x3D (common and mode page) and DIO mapping.
+   Captured once after the mode setup (ex. LR.begin(), RC.begin()), restored
+   by a burst write: switching role (LORA <-> REMOTEC) is 6 SPI transfers */
+#define ctxRegs 60
+struct SXContext {byte opmode; byte reg[ctxRegs]; byte dio[2];};
+
 class SX1278
 {
   public:
@@ -106,6 +126,14 @@ class SX1278
 /* Initialize SPI and reset SX1278
    It returns false if shield is not available */  
    bool begin();
+/* Warm start (MCU wake from deep sleep, radio kept powered in SLEEP or STDBY
+   with its registers): SPI initialized without reset. 
+   It returns false if shield is not available */
+   bool beginWarm();
+/* Signature (CRC16) of configuration registers: mode (not state), frequency,
+   power, ramp, current trim, LNA, modem configuration, preamble, sync word,
+   DIO mapping (3 burst reads) */
+   unsigned int configSignature();
    
    void restart();   //reset
    
@@ -121,10 +149,27 @@ class SX1278
    void startModeFSKOOK();
 /* 0:FSKOOK  1:LORA */
    int readMode();
+/* Capture current configuration in context c; restore context c (through 
+   SLEEP, radio left in STDBY) */
+   void getContext(SXContext &c);
+   void setContext(const SXContext &c);
    
 /* Set frequency in Mhz (SX12878 : 137-525 Mhz) (ex.: 433.92) (def.: 434.0)*/
    void setFreq(float freq); //freq in Mhz (ex.: 433.92)
    float readFreq();   
+/* Set/read frequency in Hz (exact integer, step 32MHz/2^19 = 61.035 Hz) */
+   void setFreqHz(unsigned long hz);
+   unsigned long readFreqHz();
+/* Precompute channel registers for frequency hz and set channel */
+   static SXChannel makeChannel(unsigned long hz);
+   void setChannel(const SXChannel &ch);
+/* Frequency correction (Hz) added to every frequency set (ex.: crystal error
+   measured by LoraAfc). Frequencies read are without correction */
+   void setFreqCorr(long hz);
+   long getFreqCorr();
+/* Conversion Hz <-> Frf register value (Hz*2^19/32000000) */
+   static unsigned long hzToFrf(unsigned long hz);
+   static unsigned long frfToHz(unsigned long frf);
 
 /* Set/get transmit power; pw can be:
    1 (7dBm=5mW), 2 (10dBm=10mW), 3 (13dBm=20mW), 
@@ -152,6 +197,9 @@ class SX1278
 /* Temperature onboard sensor function */
    int readTemp();
    void tempCalib();      
+/* Temperature read while in LoRa mode (switches briefly to FSK mode through
+   sleep: registers are kept, FIFO is lost). Radio is left in standby */
+   int readTempLora();
 
 /***************************** FSK/OOK mode **********************************/
 
@@ -161,9 +209,15 @@ class SX1278
    void setModulation(unsigned char mod); 
    int readModulation();
    
-/* Set bit rate (BPS) (mode FSKOOK) (def.: 4800)*/   
-   void setBPS(int bps);
+/* Set bit rate (BPS) (mode FSKOOK) (def.: 4800) (FSK up to 300000)*/   
+   void setBPS(unsigned long bps);
    unsigned int readBPS();
+/* Set FSK frequency deviation (Hz) (def.: 5000) (600-200000, with 
+   deviation + bit rate/2 <= 250000) */
+   void setFdev(unsigned long hz);
+/* Set receiver and AFC bandwidth (single side, Hz): smallest setting not 
+   less than hz (2600-250000) */
+   void setRxBw(unsigned long hz,unsigned long afcHz);
    
 /* Set/reset (1/0) Packet mode */   
    void setPackNoPack(byte yesno);
@@ -252,11 +306,25 @@ class SX1278
       
 /* Set on/off automatic payload CRC computation/detection  (def.: off)*/
    void setLoraCrc(byte yesno);   
+
+/* Implicit header mode (no PHY header, fixed payload length len) or explicit
+   header mode (def.). SF6 works only in implicit header mode */
+   void setLoraImplicitHeader(boolean on,byte len);
+   boolean getLoraImplicitHeader();
+/* Read/write frame configuration */   
+   void getLoraFrameCfg(SXFrameCfg &c);
+   void setLoraFrameCfg(const SXFrameCfg &c);
+/* Configuration c changed to implicit header, payload len and spreading 
+   factor sf (0: unchanged), with LDRO and detection registers for new SF */   
+   static SXFrameCfg implicitCfg(const SXFrameCfg &c,byte len,byte sf);
    
 /* Symbol rate computation */
    float getSRate();
 /* Bit per second (bit rate)*/
    float getLorabps();
+/* Time on air (microseconds) of a packet of plen payload bytes, computed
+   with current SF, BW, CR, preamble length, header mode and CRC setting */
+   unsigned long getLoraTimeOnAir(byte plen);
    
 /* Set on in case of simbol rate < 62/sec (or bps < 1200) */
    void setLoraLowDataRateOptimize(boolean on);
@@ -292,6 +360,8 @@ class SX1278
    int lastLoraPacketSnr();
    int getLoraRssi();
    int lastLoraPacketSignalPower();
+/* Frequency error (Hz) of last packet received (RegFei) */
+   long lastLoraPacketFreqErr();
    
 /* Set random seed using wideband RSSI noisy measuring */
    unsigned int setRndSeed();
@@ -302,6 +372,13 @@ class SX1278
    int SPIwrite(unsigned char address,unsigned char val);
 /* Basic SX1278 register read function */ 
    int SPIread(unsigned char address);
+/* Burst write/read of n consecutive registers starting from address */
+   void SPIwriteBurst(unsigned char address,const byte val[],byte n);
+   void SPIreadBurst(unsigned char address,byte val[],byte n);
+#ifdef LORA_BUSTRACE
+/* Record every SPI transaction in trace t (NULL: no trace) (see BusTrace.h) */
+   void setTrace(BusTrace* t);
+#endif
    
 /* get and set single bit of register */     
    void setRegBit(byte reg,byte n,byte onoff);
@@ -338,6 +415,14 @@ class SX1278
   private:
   
   bool initSPI();   
+  void initBus();
+#ifdef LORA_BUSTRACE
+  BusTrace* trace;              //SPI trace (NULL: none)
+#endif
+  byte irqSeen;                 //IRQ flags last seen (event trace)
+  void traceIrq(byte b);
+  long corrHz;                  //frequency correction
+  long corrFrf;                 //frequency correction in Frf units
   void setBoost(byte yesno);   
   char RegBin[18];
   byte setBit(byte b,byte val,byte bst, byte len);
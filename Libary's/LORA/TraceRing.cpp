@@ -0,0 +1,70 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "TraceRing.h"
+
+TraceRing::TraceRing(unsigned int len)
+{
+  mask=7;
+  while ((mask+1<len)&&(mask<0x3FFF)) mask=(mask<<1)|1;
+  tab=new TraceRecord[mask+1];
+  clear();
+}
+
+void TraceRing::clear(){head=0;tail=0;}
+
+void IRAM_ATTR TraceRing::add(byte code,byte arg,unsigned int val)
+{
+  unsigned long i=__atomic_fetch_add(&head,1,__ATOMIC_RELAXED);
+  TraceRecord* r=&tab[i&mask];
+  r->t=micros();r->ev=code;r->arg=arg;r->val=(val>0xFFFF)?0xFFFF:val;
+}
+
+unsigned int TraceRing::count()
+{
+  unsigned long n=head-tail;
+  return (n>mask)?mask+1:n;
+}
+
+unsigned long TraceRing::getLost()
+{
+  unsigned long n=head-tail;
+  return (n>mask)?n-mask-1:0;
+}
+
+TraceRecord* TraceRing::get(unsigned int i)
+{
+  if (i>=count()) return NULL;
+  return &tab[(head-count()+i)&mask];
+}
+
+static void hex(unsigned long v,byte digits)
+{
+  while (digits>0) {digits--;Serial.print((v>>(digits*4))&15,HEX);}
+}
+
+void TraceRing::print(const char* tag)
+{
+  unsigned int n=count();
+  Serial.print(tag);Serial.print(": n=");Serial.print(n);
+  Serial.print(" lost=");Serial.print(getLost());
+  Serial.print(" now=");Serial.println(micros());
+  for (unsigned int i=0;i<n;i++)
+  {
+    TraceRecord* r=get(i);
+    if ((i&7)==0) {Serial.print(tag);Serial.print(":");}
+    hex(r->t,8);hex(r->ev,2);hex(r->arg,2);hex(r->val,4);
+    if (((i&7)==7)||(i==n-1)) Serial.println();
+  }
+  Serial.print(tag);Serial.println(": end");
+  clear();
+}
@@ -0,0 +1,67 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Class TraceRing.
+*  Ring buffer of 8 bytes records shared by LoraTrace (events) and BusTrace 
+*  (bus transactions): time (us), two codes and a 16 bits value. Size is a 
+*  power of 2, the oldest records are overwritten. A slot is reserved by an 
+*  atomic increment (no interrupts disabled).
+*  Dump format (text lines, mixed with other output; TAG: ET or BT): 
+*    "TAG: n=<records> lost=<overwritten> now=<us>"
+*    "TAG:" + up to 8 records of 16 hex digits (ttttttttccaavvvv)
+*    "TAG: end"
+*/
+
+#ifndef TraceRing_h
+#define TraceRing_h
+
+#include <Arduino.h>
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+struct TraceRecord
+{
+  uint32_t t;                    //time (us)
+  union {byte ev;byte bus;};     //event (LoraTrace), bus code (BusTrace)
+  union {byte arg;byte addr;};   //argument, register or device address
+  union {uint16_t val;uint16_t len;};  //value, bytes transferred
+};
+
+class TraceRing
+{
+  public:
+  
+/* Records in buffer and records overwritten */  
+  unsigned int count();
+  unsigned long getLost();
+/* Record i (0 is the oldest), NULL if i>=count() */  
+  TraceRecord* get(unsigned int i);
+  void clear();
+
+  protected:
+/* Buffer of len records (rounded to power of 2, 8 to 16384) */  
+  TraceRing(unsigned int len);
+  void IRAM_ATTR add(byte code,byte arg,unsigned int val);
+/* Print buffer on Serial (see format) and clear it */  
+  void print(const char* tag);
+
+  private:
+  TraceRecord* tab;
+  unsigned int mask;
+  unsigned long head;            //records written
+  unsigned long tail;            //first record in buffer
+};
+
+#endif
@@ -0,0 +1,45 @@
+/* This sketch realizes a polling server (id = 1) that collects the sensor value of nodes
+ * 2 to "maxdevice" with a single broadcast request.
+ * Every node replies in its own time slot and the server acknowledges all replies with
+ * a single bitmap message (instead of one acknowledge for each node).
+ * Use it with BroadcastPolledDev sketch.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(1);           //Instance node 1 (server)
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+
+int maxdevice=15;
+
+int timing=10000;           //server polls all devices every 10 seconds
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.printConfig();       //Print radio config (for information)
+  Node.printAddresses();    //Print network data (for information)
+  Serial.println("Start broadcast polling server");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  byte req[]="GiveMeVal";
+  int n=Node.pollBroadcast(req,9,2,maxdevice-1,2,false,getVal); //replies of 2 bytes
+  Serial.print("Replies: ");Serial.println(n);
+  for (int i=2;i<=maxdevice;i++) if (!Node.pollReplied(i)) norep(i);
+  delay(timing);
+}
+
+void getVal(int dev,byte* data,int len)  //called for every reply
+{
+  int val=word(data[0],data[1]);
+  Serial.print("Device: ");Serial.print(dev);Serial.print("  value: ");Serial.println(val);
+  //or change with your code for devices replay
+}
+
+void norep(int dev)
+{
+  Serial.print("Device ");Serial.print(dev);Serial.println(" no responding!");
+}
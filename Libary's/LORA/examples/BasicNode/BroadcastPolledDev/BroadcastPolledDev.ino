@@ -0,0 +1,33 @@
+/* This sketch acts as a remote device for BroadcastPollServer. This device reads a value 
+ * on analogical pin "pana" and sends it to the polling server (id 1) in its time slot,
+ * when a broadcast poll arrives.
+ * This sketch uses a defined address 2 for simplicity. 
+ * Other devices need a different node id or load it from EEPROM.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(2);           //Instance node 2
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+#define pana 2              //Analogic pin
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.printConfig();       //Print radio config (for information)
+  Node.printAddresses();    //Print network data (for information)
+  Serial.println("Start remote device");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (Node.newMessAvailable(1,20000) && Node.isPoll()) {replay();}
+}
+
+void replay()
+{
+  int v=analogRead(pana);                   //read value
+  byte bv[2]={highByte(v),lowByte(v)};      //2 bytes binary value
+  if (!Node.replyToPoll(bv,2)) Serial.println("Reply not acknowledged");
+}
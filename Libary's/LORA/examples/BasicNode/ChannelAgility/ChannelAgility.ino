@@ -0,0 +1,46 @@
+/* This sketch realizes a coordinator (id = 1) that keeps its network on the least 
+ * busy channel of a channel plan.
+ * Every minute it samples all channels with CAD; if another channel is clearly
+ * better it announces the switch and all nodes change channel at the same time.
+ * Nodes must use the same channel plan (setChannelPlan()) and receive messages 
+ * (or call processChannel()) to follow the switch.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(1);           //Instance node 1 (coordinator)
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+
+unsigned long plan[]={433175000,433375000,433575000,433775000,433975000,434175000};
+
+int timing=60000;           //channels are checked every minute
+unsigned long last=0;
+
+void setup() {
+  Serial.begin(9600);
+  Node.setChannelPlan(plan,6);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.printConfig();       //Print radio config (for information)
+  Serial.println("Start channel agility coordinator");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (Node.newMessAvailable(1000))
+    {Serial.print(Node.getSender());Serial.print(": ");Serial.println(Node.getMessage());}
+  if (millis()-last<timing) return;
+  last=millis();
+  byte best=Node.scanChannels(20);
+  byte cur=Node.getChannel();
+  for (int ch=0;ch<Node.getChannelCount();ch++)
+  {
+    Serial.print("Channel ");Serial.print(ch);Serial.print(" busy: ");Serial.print(Node.getChannelBusy(ch));
+    Serial.print(" loss: ");Serial.println(Node.getChannelLoss(ch));
+  }
+  if ((best!=cur)&&(Node.getChannelBusy(cur)-Node.getChannelBusy(best)>0.2))
+  {
+    Serial.print("Move network to channel ");Serial.println(best);
+    Node.announceChannelSwitch(best,3000);
+  }
+}
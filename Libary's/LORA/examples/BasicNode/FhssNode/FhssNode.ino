@@ -0,0 +1,44 @@
+/* This sketch realizes a node that sends and receives messages with frequency 
+ * hopping: every packet hops on 8 channels (change every 20 symbols), following
+ * the sequence generated by the shared seed.
+ * Load it on two boards with different node id (1 and 2): node 1 sends a message
+ * to node 2 every 10 seconds, node 2 prints it.
+ * Radio DIO2 must be connected (pin HOPPIN) for hopping interrupt.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+#define THISNODE 1          //change to 2 on the second board
+#define HOPPIN   32         //pin connected to radio DIO2 
+
+LoraNode Node(THISNODE);    
+LoraHop Hop;
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+
+unsigned long hopch[]={433100000,433300000,433500000,433700000,433900000,434100000,434300000,434500000};
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  if (!Hop.begin(hopch,8,1234,20,HOPPIN)) {Serial.println("Hopping not started!");return;}
+  Node.LR.setHopping(&Hop);
+  Node.printConfig();       //Print radio config (for information)
+  Serial.println("Start FHSS node");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (THISNODE==1)
+  {
+    if (Node.writeMessage(2,"Hello hopping",500)) Serial.println("Sent");
+    else Serial.println("Not acknowledged");
+    Serial.print("Hops: ");Serial.println(Hop.getHops());
+    delay(10000);
+  }
+  else if (Node.newMessAvailable(1000))
+  {
+    Serial.print(Node.getSender());Serial.print(": ");Serial.println(Node.getMessage());
+    Serial.print("RSSI: ");Serial.println(SX.lastLoraPacketRssi());
+  }
+}
@@ -0,0 +1,42 @@
+/* Bulk transfer in FSK packet mode: node 1 sends 253 bytes packets to 
+ * node 2 at 100 kbps, node 2 prints throughput and statistics every 10 s.
+ * Packets longer than radio FIFO (64 bytes) are streamed: FIFO is refilled
+ * (TX) or drained (RX) in 32 bytes chunks on FifoLevel.
+ * FIFO is served by polling in send/receive; if radio DIO0 and DIO1 are 
+ * connected (TTGO: 26 and 33) flags are read only after their interrupts.
+ */
+
+#include "LoraFsk.h"        //Include library 
+
+#define NODE     2          //1: sender, 2: receiver
+#define DIO0PIN  26         //pin connected to radio DIO0
+#define DIO1PIN  33         //pin connected to radio DIO1
+
+LoraFsk Fsk;
+byte buff[fskMaxData];
+unsigned long bytes=0;
+unsigned long tm;
+
+void setup() {
+  Serial.begin(115200);
+  SX.begin();
+  if (!Fsk.begin(434000000,100000,NODE)) {Serial.println("No radio!");return;}
+  Fsk.setPins(DIO0PIN,DIO1PIN);
+  Serial.print("Packet time on air (us): ");Serial.println(Fsk.timeOnAir(fskMaxData));
+  for (int i=0;i<fskMaxData;i++) buff[i]=i;
+  tm=millis();
+}
+
+void loop() {
+  if (NODE==1) {if (Fsk.send(2,buff,fskMaxData)) bytes+=fskMaxData;}
+  else bytes+=Fsk.receive(buff,sizeof(buff),100);
+  if (millis()-tm<10000) return;
+  FskStats* st=Fsk.getStats();
+  Serial.print("kbit/s: ");Serial.print(bytes*8/10000);
+  Serial.print(" tx: ");Serial.print(st->txPackets);
+  Serial.print(" rx: ");Serial.print(st->rxPackets);
+  Serial.print(" crc: ");Serial.print(st->rxCrcErr);
+  Serial.print(" overrun: ");Serial.print(st->rxOverrun);
+  Serial.print(" rssi: ");Serial.println(Fsk.getRssi());
+  bytes=0;tm=millis();
+}
@@ -0,0 +1,45 @@
+/* This sketch acts as a remote device (like PolledDev) that keeps link and
+ * MAC statistics: every "period" milliseconds it prints counters, RSSI/SNR
+ * histograms and delivery ratio to the server (id 1), then sends the binary
+ * export of statistics to the server and resets them.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(2);           //Instance node 2
+LoraPeers Peers(16);        //Peer table (delivery ratio per peer)
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+#define pana 2              //Analogic pin
+unsigned long period=60000; //statistics period (ms)
+unsigned long last=0;
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.setAutomaticAck(true);
+  Node.setPeerTable(&Peers);
+  Serial.println("Start remote device with statistics");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (Node.newMessAvailable(1,1000)) replay();
+  if (millis()-last>=period) {report();last=millis();}
+}
+
+void replay()
+{
+  char sv[10]; 
+  itoa(analogRead(pana),sv,10); 
+  Node.writeMessage(1,sv,500);
+}
+
+void report()
+{
+  Node.printStats();
+  Serial.print("Delivery to server: ");Serial.println(Node.getPeerDelivery(1));
+  byte buff[200];
+  int n=Node.exportStats(buff,200);
+  if ((n>0)&&Node.writeMessageByte(1,buff,n,500)) Node.resetStats();
+}
@@ -0,0 +1,49 @@
+/* This sketch realizes a polling server (id = 1) like PollingServer, but using
+ * request/response: the value sent by the device acknowledges the request, so
+ * every interrogation costs two frames instead of four (request, AK, value, AK).
+ * Use it with RequestDev sketch.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(1);           //Instance node 1 (server)
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+
+int maxdevice=15;
+
+int timing=10000;           //server scans all devices every 10 seconds
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.printConfig();       //Print radio config (for information)
+  Node.printAddresses();    //Print network data (for information)
+  Serial.println("Start request server");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  byte req[]="GiveMeVal";
+  for (int i=2;i<=maxdevice;i++)
+  {
+    int n=Node.request(i,req,9,1500,100);   //response within 1.5 sec
+    if (n>0) getVal(i);
+    else if (n==0) {Serial.print("Device ");Serial.print(i);Serial.println(" acknowledged without value");}
+    else norep(i);
+  }
+  delay(timing);
+}
+
+void getVal(int dev)
+{
+  byte* mess=Node.getMessageByte();
+  int val=word(mess[0],mess[1]);
+  Serial.print("Device: ");Serial.print(dev);Serial.print("  value: ");Serial.println(val);
+  //or change with your code for devices replay
+}
+
+void norep(int dev)
+{
+  Serial.print("Device ");Serial.print(dev);Serial.println(" no responding!");
+}
@@ -0,0 +1,44 @@
+/* This sketch realizes a server (id = 1) that interrogates devices 2 to "maxdevice"
+ * with pipelined requests: requests to all devices are sent one after the other
+ * without waiting, and responses are collected as they arrive.
+ * Every response is passed to function getVal.
+ * Use it with RequestDev sketch.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(1);           //Instance node 1 (server)
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+
+int maxdevice=8;
+
+int timing=10000;           //server scans all devices every 10 seconds
+unsigned long last=0;
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.printConfig();       //Print radio config (for information)
+  Node.printAddresses();    //Print network data (for information)
+  Serial.println("Start RPC server");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (millis()-last>timing)
+  {
+    last=millis();
+    byte req[]="GiveMeVal";
+    for (int i=2;i<=maxdevice;i++) Node.rpcSend(i,req,9,4000,getVal);  //responses within 4 sec
+  }
+  if (Node.rpcPoll(100))    //other messages
+    {Serial.print(Node.getSender());Serial.print(": ");Serial.println(Node.getMessage());}
+}
+
+void getVal(byte id,int dev,byte state,byte* data,int len)  //called for every request
+{
+  if (state!=RpcDone) {Serial.print("Device ");Serial.print(dev);Serial.println(" no responding!");return;}
+  int val=word(data[0],data[1]);
+  Serial.print("Device: ");Serial.print(dev);Serial.print("  value: ");Serial.println(val);
+}
@@ -0,0 +1,46 @@
+/* This sketch acts as a remote device that reads analogical pin "pana" every second
+ * and sends compressed readings to server node 1 every "nread" readings.
+ * Readings (time in seconds, value) are compressed by LoraStream: with a constant
+ * period and a slow changing value each reading needs a couple of bytes.
+ * If a message is not acknowledged next message is a keyframe (resync).
+ * Use it with StreamServer sketch.
+ */
+
+#include "LoraNode.h"       //Include library 
+#include "LoraStream.h"
+
+LoraNode Node(2);           //Instance node 2
+LoraStream St(StreamInt);   //Integer values stream
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+#define pana 2              //Analogic pin
+#define server 1            //Server node
+
+int nread=20;               //readings for each message
+byte buff[receiveBufferLen];
+int n=0;
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.setAutomaticAck(true);
+  Node.printConfig();       //Print radio config (for information)
+  Node.printAddresses();    //Print network data (for information)
+  St.beginFrame(server,buff,receiveBufferLen-3);
+}
+
+void loop() {
+  if (!SHIELD) return;
+  unsigned long ts=millis()/1000;
+  bool full=!St.addInt(ts,analogRead(pana));
+  if (!full) n++;
+  if (full||(n>=nread)) 
+  {
+    int len=St.endFrame();
+    if (!Node.writeMessageByte(server,buff,len,500)) St.resync(server);
+    St.beginFrame(server,buff,receiveBufferLen-3);
+    n=0;
+    if (full) {St.addInt(ts,analogRead(pana));n++;}
+  }
+  delay(1000);
+}
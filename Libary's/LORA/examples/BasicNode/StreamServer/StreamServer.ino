@@ -0,0 +1,37 @@
+/* This sketch realizes a server (id = 1) that receives compressed readings from
+ * StreamDev devices and prints them on Serial port.
+ * If a message is lost, messages of that device are discarded until next keyframe.
+ */
+
+#include "LoraNode.h"       //Include library 
+#include "LoraStream.h"
+
+LoraNode Node(1);           //Instance node 1 (server)
+LoraStream St(StreamInt);   //Integer values stream
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+
+byte buff[receiveBufferLen+6];
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.setAutomaticAck(true);
+  Node.printConfig();       //Print radio config (for information)
+  Node.printAddresses();    //Print network data (for information)
+  Serial.println("Start stream server");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (!Node.newMessByteAvailable(0,buff,receiveBufferLen+6,1000)) return;
+  int dev=Node.getSender();
+  int n=St.beginDecode(dev,Node.getMessageByte(),Node.getNumByteReceived());
+  if (n<0) {Serial.print("Device ");Serial.print(dev);Serial.println(" waiting keyframe");return;}
+  unsigned long ts;long val;
+  while (St.nextInt(&ts,&val))
+  {
+    Serial.print("Device: ");Serial.print(dev);Serial.print("  time: ");Serial.print(ts);
+    Serial.print("  value: ");Serial.println(val);
+  }
+}
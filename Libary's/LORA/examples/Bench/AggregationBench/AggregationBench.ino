@@ -0,0 +1,41 @@
+/* This sketch compares the airtime needed to send small messages one by one 
+ * with the airtime needed when messages are grouped by queueMessage().
+ * For every message length (2 to 10 bytes) it computes time on air of a 
+ * single frame and of the frames needed for "nmess" grouped messages, 
+ * using the radio configuration of the node (default SF, BW, CR).
+ * Results are printed on Serial port. No message is transmitted.
+ */
+
+#include "LoraNode.h"       //Include library 
+
+LoraNode Node(1);           //Instance
+
+int nmess=10;               //messages grouped in the test
+
+void setup() {
+  Serial.begin(9600);
+  if (!Node.begin()) {Serial.println("No LoRa module!");return;}
+  Node.printConfig();       //Print radio config (for information)
+  Serial.println("Len  Single(ms)  Grouped(ms/mess)  Saved(ms/mess)");
+  for (int len=2;len<=10;len++) bench(len);
+}
+
+void bench(int len)
+{
+  float single=SX.getLoraTimeOnAir(Node.LR.getFrameLen(len))/1000.0;
+  int perframe=maxBatchLen/(len+2);                  //messages in a frame
+  int nframes=(nmess+perframe-1)/perframe;
+  float grouped=0;
+  for (int f=0;f<nframes;f++)
+  {
+    int n=min(perframe,nmess-f*perframe);
+    grouped+=SX.getLoraTimeOnAir(Node.LR.getFrameLen(2+n*(len+2)))/1000.0;
+  }
+  grouped=grouped/nmess;
+  Serial.print(len);Serial.print("    ");Serial.print(single);
+  Serial.print("      ");Serial.print(grouped);
+  Serial.print("             ");Serial.println(single-grouped);
+}
+
+void loop() {
+}
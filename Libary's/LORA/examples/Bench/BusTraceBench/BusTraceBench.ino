@@ -0,0 +1,50 @@
+/* This sketch records the bus workload of a polled device with display:
+ * every SPI transaction of SX1278 and every I2C transaction of the SSD1306
+ * display are stored in a BusTrace ring buffer, dumped on Serial port every
+ * "period" milliseconds. Copy the serial monitor log in a file and replay it
+ * on PC with extras/LoraSim/TraceReplay.cpp (transactions, bytes, bus time).
+ * SPI trace must be enabled: uncomment "#define LORA_BUSTRACE" in BusTrace.h
+ * (or add -DLORA_BUSTRACE to build flags).
+ * Display on TTGO LoRa32 (address 0x3C, SDA 21, SCL 22).
+ */
+
+#include "LoraNode.h"       //Include library 
+#include "BusTrace.h"
+#include "SSD1306Wire.h"
+
+#ifndef LORA_BUSTRACE
+#error "Enable LORA_BUSTRACE in BusTrace.h"
+#endif
+
+LoraNode Node(2);           //Instance node 2
+BusTrace BT(512);           //Trace of 512 records (4 KB)
+SSD1306Wire display(0x3C,21,22);
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+unsigned long period=10000; //dump period (ms)
+unsigned long last=0;
+
+void i2cTrace(uint8_t addr,uint16_t len) {BT.record(BusI2C,addr,len);}
+
+void setup() {
+  Serial.begin(115200);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  display.init();
+  SX.setTrace(&BT);               //trace SPI
+  display.setTraceHook(i2cTrace); //trace I2C
+  Serial.println("Start bus trace");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (Node.newMessAvailable(1,1000))
+  {
+    char sv[10];
+    itoa(analogRead(2),sv,10);
+    Node.writeMessage(1,sv,500);
+    display.clear();
+    display.drawString(0,0,sv);
+    display.display();
+  }
+  if (millis()-last>=period) {BT.dump();last=millis();}
+}
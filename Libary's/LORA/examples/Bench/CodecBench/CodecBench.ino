@@ -0,0 +1,72 @@
+/* This sketch checks LoraCodec and compares the size of binary coded messages 
+ * with the same values sent as text (as PolledDev does with itoa).
+ * A typical record is coded and decoded "ntest" times with random values:
+ * temperature (1 decimal), pressure, humidity (optional), 2 status bits and
+ * analog value. Errors, mean sizes and frame lengths are printed on Serial port.
+ * No radio module is needed.
+ */
+
+#include "LORA.h"
+#include "LoraCodec.h"
+
+const CodecField sch[]={{FldFixed,1},          //temperature 
+                        {FldUInt,0},           //pressure 
+                        {FldUInt|FldOpt,0},    //humidity 
+                        {FldBits,2},           //status
+                        {FldInt,0}};           //analog value
+LoraCodec Cd(sch,5);
+LORA LR;
+
+long ntest=1000;
+
+void setup() {
+  Serial.begin(9600);
+  byte buff[32];
+  char text[64];
+  long errors=0;
+  long binlen=0;
+  long txtlen=0;
+  long binframe=0;
+  long txtframe=0;
+  unsigned long t=micros();
+  for (long i=0;i<ntest;i++)
+  {
+    float temp=random(-200,400)/10.0;
+    unsigned int press=random(950,1050);
+    bool hum=random(2);
+    unsigned int humv=random(100);
+    byte st=random(4);
+    int ana=random(1024);
+    Cd.beginEncode(buff,32);
+    Cd.putFloat(temp);Cd.putUInt(press);
+    if (hum) Cd.putUInt(humv); else Cd.skip();
+    Cd.putBits(st);Cd.putInt(ana);
+    int n=Cd.endEncode();
+    
+    Cd.beginDecode(buff,n);
+    if (abs(Cd.getFloat()-temp)>0.05) errors++;
+    if (Cd.getUInt()!=press) errors++;
+    if (Cd.isPresent()!=hum) errors++;
+    unsigned int h=Cd.getUInt(); if (hum&&(h!=humv)) errors++;
+    if (Cd.getBits()!=st) errors++;
+    if (Cd.getInt()!=ana) errors++;
+    if (!Cd.endDecode()) errors++;
+
+    int l=sprintf(text,"%d.%d;%u;",(int)temp,abs((int)(temp*10))%10,press);
+    if (hum) l+=sprintf(&text[l],"%u",humv);
+    l+=sprintf(&text[l],";%u;%d",st,ana);
+    
+    binlen+=n;txtlen+=l;
+    binframe+=LR.getFrameLen(n);txtframe+=LR.getFrameLen(l);
+  }
+  t=micros()-t;
+  Serial.print("Round trip errors: ");Serial.println(errors);
+  Serial.print("Mean binary bytes: ");Serial.print((float)binlen/ntest);
+  Serial.print("  frame: ");Serial.println((float)binframe/ntest);
+  Serial.print("Mean text bytes  : ");Serial.print((float)txtlen/ntest);
+  Serial.print("  frame: ");Serial.println((float)txtframe/ntest);
+  Serial.print("Test time (us/record, codec and text): ");Serial.println((float)t/ntest);
+}
+
+void loop() {
+}
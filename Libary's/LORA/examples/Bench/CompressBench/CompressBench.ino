@@ -0,0 +1,45 @@
+/* This sketch measures LoraLZ compression on payloads like the ones sent by
+ * LoraNode::writeMessage: a configuration blob, text log lines and sensor values 
+ * as text. For every payload it prints original and compressed length, frame
+ * length on air (with and without compression) and compression/decompression
+ * speed. No radio module is needed.
+ */
+
+#include "LORA.h"
+#include "LoraLZ.h"
+
+LORA LR;
+
+const char* payloads[]={
+  "{\"node\":12,\"net\":2345,\"freq\":433600000,\"sf\":10,\"bw\":8,\"cr\":4,\"pwr\":2,\"ack\":1,\"batch\":500}",
+  "12:00:01 node 3 rx ok rssi -97 snr 6;12:00:11 node 3 rx ok rssi -98 snr 5;12:00:21 node 3 rx ok rssi -97 snr 6",
+  "T=21.5;H=54;P=1013;T=21.6;H=54;P=1013;T=21.6;H=55;P=1012;T=21.7;H=55;P=1012",
+  "GiveMeVal"};
+  
+int nrep=100;
+
+void setup() {
+  Serial.begin(9600);
+  byte z[lzMaxLen];
+  byte u[lzMaxLen+1];
+  Serial.println("Len  Zip  Frame  ZipFrame  Zip(us)  Unzip(us)  Ok");
+  for (int p=0;p<4;p++)
+  {
+    int len=strlen(payloads[p]);
+    unsigned long t0=micros();
+    int zl=0;
+    for (int r=0;r<nrep;r++) zl=LoraLZ::compress((byte*)payloads[p],len,z,lzMaxLen);
+    unsigned long t1=micros();
+    int ul=0;
+    for (int r=0;r<nrep;r++) ul=LoraLZ::decompress(z,zl,u,lzMaxLen);
+    unsigned long t2=micros();
+    bool ok=(ul==len)&&(memcmp(u,payloads[p],len)==0);
+    Serial.print(len);Serial.print("  ");Serial.print(zl);Serial.print("  ");
+    Serial.print(LR.getFrameLen(len));Serial.print("    ");Serial.print(LR.getFrameLen(zl));
+    Serial.print("       ");Serial.print((t1-t0)/nrep);Serial.print("      ");
+    Serial.print((t2-t1)/nrep);Serial.print("        ");Serial.println(ok?"yes":"NO");
+  }
+}
+
+void loop() {
+}
@@ -0,0 +1,42 @@
+/* This sketch traces radio events of a device sending a message to node 1
+ * with acknowledge every "period" milliseconds: state changes, IRQ flags, 
+ * transmissions, CAD, acknowledge waits and retries are recorded with time 
+ * (us) in a ring buffer. The buffer is dumped on Serial port when it is 
+ * nearly full or when "d" is received; the serial log is decoded on PC by 
+ * extras/LoraSim/TraceTimeline.cpp (timeline and intervals summary).
+ * The application records its own events (EvUser and up).
+ */
+
+#include "LoraNode.h"       //Include library 
+#include "LoraTrace.h"
+
+LoraNode Node(2);           //Instance node 2
+LoraTrace ET(256);          //Event trace (256 events)
+
+#define EvMeasure EvUser    //application event: measure taken (val: value)
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+unsigned long period=10000; //send period (ms)
+unsigned long last=0;
+
+void setup() {
+  Serial.begin(115200);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.setAutomaticAck(true);
+  ET.start();
+  Serial.println("Event trace started");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (millis()-last>=period)
+  {
+    last=millis();
+    char sv[10];
+    int v=analogRead(2);
+    ET.record(EvMeasure,0,v);
+    itoa(v,sv,10);
+    Node.writeMessage(1,sv,1000);
+  }
+  if ((ET.count()>200)||(Serial.read()=='d')) ET.dump();
+}
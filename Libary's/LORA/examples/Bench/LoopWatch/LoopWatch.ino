@@ -0,0 +1,51 @@
+/* This sketch finds blocking calls that starve the receive path of a node 
+ * with display: library calls longer than 20 ms and loops longer than 
+ * 100 ms are counted; every overrun of the receive call is printed at once
+ * by the alarm function and the offenders table is printed on Serial port 
+ * every "period" milliseconds. The splash screen delay is marked as 
+ * application call (WatchUser0).
+ * Display on TTGO LoRa32 (address 0x3C, SDA 21, SCL 22).
+ */
+
+#include "LoraNode.h"       //Include library 
+#include "LoraWatch.h"
+#include "SSD1306Wire.h"
+
+LoraNode Node(2);           //Instance node 2
+LoraWatch LW(20000);        //Budget 20 ms for library calls
+SSD1306Wire display(0x3C,21,22);
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+unsigned long period=60000; //table period (ms)
+unsigned long last=0;
+
+void overrun(byte point,unsigned long us)
+{
+  if (point!=WatchNodeRx) return;
+  Serial.print("Overrun ");Serial.print(LW.name(point));
+  Serial.print(" ");Serial.print(us);Serial.println(" us");
+}
+
+void setup() {
+  Serial.begin(115200);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  LW.setBudget(WatchLoop,100000);
+  LW.setAlarm(overrun);
+  LW.start();
+  display.init();
+  display.drawString(0,0,"Node 2");
+  display.display();
+  {WATCH_SCOPE(WatchUser0);delay(2000);}   //splash screen
+}
+
+void loop() {
+  if (!SHIELD) return;
+  LW.loop();
+  if (Node.newMessAvailable(1,50))
+  {
+    display.clear();
+    display.drawString(0,0,Node.getMessage());
+    display.display();
+  }
+  if (millis()-last>=period) {LW.dump();LW.reset();last=millis();}
+}
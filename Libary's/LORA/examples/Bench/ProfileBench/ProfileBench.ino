@@ -0,0 +1,45 @@
+/* This sketch profiles a polled device with display: time spent in AES, 
+ * drawString and display flush, SX1278 flag polls and SPI transactions, 
+ * and the whole reply (user probe ProfUser0). Stats are printed on Serial 
+ * port every "period" milliseconds (outside the timed code).
+ * Profiling must be enabled: uncomment "#define LORA_PROFILE" in LoraProf.h
+ * (or add -DLORA_PROFILE to build flags).
+ * Display on TTGO LoRa32 (address 0x3C, SDA 21, SCL 22).
+ */
+
+#include "LoraNode.h"       //Include library 
+#include "LoraProf.h"
+#include "SSD1306Wire.h"
+
+#ifndef LORA_PROFILE
+#error "Enable LORA_PROFILE in LoraProf.h"
+#endif
+
+LoraNode Node(2);           //Instance node 2
+SSD1306Wire display(0x3C,21,22);
+
+bool SHIELD=true;           //Flag to verify correct link with radio module
+unsigned long period=30000; //stats period (ms)
+unsigned long last=0;
+
+void setup() {
+  Serial.begin(115200);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  display.init();
+  Serial.println("Start profiling");
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (Node.newMessAvailable(1,1000))
+  {
+    PROF_SCOPE(ProfUser0);
+    char sv[10];
+    itoa(analogRead(2),sv,10);
+    Node.writeMessage(1,sv,500);
+    display.clear();
+    display.drawString(0,0,sv);
+    display.display();
+  }
+  if (millis()-last>=period) {LoraProf::dump();LoraProf::reset();last=millis();}
+}
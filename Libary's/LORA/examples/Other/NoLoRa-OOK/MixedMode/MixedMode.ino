@@ -0,0 +1,38 @@
+/* Mixed mode device: LoRa node 2 receiving commands from node 1 and remote
+ * 220V switch (Avidsen) on the same radio. Message "on1".."on5" or 
+ * "of1".."of5" switches a socket. Both configurations are captured once as 
+ * radio contexts; changing role restores a context by burst writes instead
+ * of running the whole setup of each class.
+ */
+
+#include "LoraNode.h"
+#include "REMOTEC.h"
+
+LoraNode Node(2);           //Instance node 2
+REMOTEC RC;
+
+SXContext loraCtx;          //LoRa node configuration
+SXContext ookCtx;           //remote control configuration
+
+byte addAv[5]={2,0,2,0,0};
+bool SHIELD=true;
+
+void setup() {
+  Serial.begin(115200);
+  if (!Node.begin()) {Serial.println("No LoRa module!");SHIELD=false;return;}
+  Node.setAutomaticAck(true);
+  SX.getContext(loraCtx);
+  RC.setTransmitMode();     //OOK setup (once)
+  SX.getContext(ookCtx);
+  SX.setContext(loraCtx);
+}
+
+void loop() {
+  if (!SHIELD) return;
+  if (!Node.newMessAvailable(1,1000)) return;
+  char* m=Node.getMessage();
+  if ((m[0]!='o')||(m[2]<'1')||(m[2]>'5')) return;
+  SX.setContext(ookCtx);
+  RC.avidsenSet(addAv,m[2]-'0',(m[1]=='n')?1:0);
+  SX.setContext(loraCtx);
+}
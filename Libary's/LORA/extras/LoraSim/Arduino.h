@@ -0,0 +1,139 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Arduino core subset for host builds of the library (LoraSim).
+*  Time, SPI, EEPROM, random and Serial are provided by the simulator
+*  (SimArduino.cpp) for the node running; time comes from the HostClock.
+*  String and Wire are enough for OLEDDisplay (build with -DARDUINO=10805).
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW  0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+#define DEC 10
+#define HEX 16
+#define BIN 2
+#define B111 7
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(a) (*(const uint8_t*)(a))
+
+#define bitRead(v,b) (((v)>>(b))&1)
+#define bitSet(v,b) ((v)|=(1UL<<(b)))
+#define bitClear(v,b) ((v)&=~(1UL<<(b)))
+#define bitWrite(v,b,x) ((x)?bitSet(v,b):bitClear(v,b))
+#define lowByte(w) ((uint8_t)((w)&0xff))
+#define highByte(w) ((uint8_t)((w)>>8))
+inline unsigned int word(uint8_t h,uint8_t l){return (h<<8)|l;}
+inline unsigned int word(unsigned int w){return w;}
+template<class T,class U> inline T min(T a,U b){return a<(T)b?a:(T)b;}
+template<class T,class U> inline T max(T a,U b){return a>(T)b?a:(T)b;}
+template<class T,class U,class V> inline T constrain(T x,U a,V b){return x<(T)a?(T)a:(x>(T)b?(T)b:x);}
+
+void delay(unsigned long ms); 
+void delayMicroseconds(unsigned int us);
+unsigned long millis(); 
+unsigned long micros(); 
+void yield();
+
+long random(long hi); 
+long random(long lo,long hi); 
+void randomSeed(unsigned long s);
+
+void pinMode(uint8_t pin,uint8_t mode);
+void digitalWrite(uint8_t pin,uint8_t val); 
+int digitalRead(uint8_t pin); 
+int analogRead(uint8_t pin); 
+unsigned long pulseIn(uint8_t pin,uint8_t state,unsigned long tout=1000000);
+void attachInterrupt(uint8_t n,void (*isr)(void),int mode); 
+void detachInterrupt(uint8_t n);
+inline uint8_t digitalPinToInterrupt(uint8_t p){return p;}
+void noInterrupts(); 
+void interrupts();
+char* itoa(int val,char* s,int radix);
+
+class String
+{
+  public:
+  String(const char* c=""){s=(c==NULL)?"":c;}
+  String(char c){s=c;}
+  String(int v,int base=DEC){char t[34];s=itoa(v,t,base);}
+  unsigned int length() const {return s.length();}
+  const char* c_str() const {return s.c_str();}
+  void toCharArray(char* b,unsigned int n,unsigned int i=0) const
+    {if (n==0) return;size_t k=(i<s.length())?s.copy(b,n-1,i):0;b[k]=0;}
+  String& operator+=(const String& o){s+=o.s;return *this;}
+  String operator+(const String& o) const {String r(*this);r+=o;return r;}
+  bool operator==(const char* c) const {return s==c;}
+  private:
+  std::string s;
+};
+
+class Print
+{
+  public:
+  virtual size_t write(uint8_t c)=0;
+  size_t write(const uint8_t* b,size_t n){size_t i;for (i=0;i<n;i++) write(b[i]);return n;}
+  size_t print(const char* s){return write((const uint8_t*)s,strlen(s));}
+  size_t print(char c){return write((uint8_t)c);}
+  size_t print(const String& s){return print(s.c_str());}
+  size_t print(unsigned char v,int base=DEC){return print((unsigned long)v,base);}
+  size_t print(int v,int base=DEC){return print((long)v,base);}
+  size_t print(unsigned int v,int base=DEC){return print((unsigned long)v,base);}
+  size_t print(long v,int base=DEC);
+  size_t print(unsigned long v,int base=DEC);
+  size_t print(double v,int dig=2);
+  size_t println(){return print("\r\n");}
+  template<class T> size_t println(T v){size_t n=print(v);return n+println();}
+  template<class T> size_t println(T v,int f){size_t n=print(v,f);return n+println();}
+};
+
+class HardwareSerial : public Print
+{
+  public:
+  void begin(unsigned long baud){}
+  int available(){return 0;}
+  int read(){return -1;}
+  size_t readBytes(uint8_t* b,size_t n){return 0;}
+  long parseInt(){return 0;}
+  void flush(){}
+  size_t write(uint8_t c);
+  using Print::write;
+  operator bool(){return true;}
+};
+
+extern HardwareSerial Serial;
+
+#endif
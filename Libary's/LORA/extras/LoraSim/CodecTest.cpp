@@ -0,0 +1,251 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Round trip and edge case tests of LoraCodec on host: varint limits (32 
+   bits values), zigzag extremes, fixed point rounding, optional fields 
+   (presence bits), bitfield packing and error cases. Then random records of
+   the CodecBench schema are coded and decoded and their size is compared 
+   with the same values as text.
+   Values are 32 bits as on the boards (long is 64 bits on host).
+   Build:
+     g++ -O2 -std=gnu++11 -fpermissive -I. -I../.. -o codectest CodecTest.cpp
+         SimArduino.cpp LoraSim.cpp HostClock.cpp ../../[A-Z]*.cpp
+   Run: ./codectest [records=10000]   (exit status 1 if any test fails)
+*/
+
+#include "LoraSim.h"
+#include <LORA.h>
+#include <LoraCodec.h>
+#include "HostTest.h"
+
+static void varintLimits()
+{
+  const unsigned long v[]={0,1,127,128,16383,16384,2097151,2097152,268435455,268435456,0xFFFFFFFFUL};
+  const int len[]={1,1,1,2,2,3,3,4,4,5,5};
+  byte b[8];
+  unsigned long r;
+  for (int i=0;i<11;i++)
+  {
+    CHECK(LoraCodec::writeVarint(b,8,v[i])==len[i]);
+    CHECK((LoraCodec::readVarint(b,8,&r)==len[i])&&(r==v[i]));
+    CHECK(LoraCodec::writeVarint(b,len[i]-1,v[i])==0);      //no space
+    CHECK(LoraCodec::readVarint(b,len[i]-1,&r)==0);         //truncated
+  }
+  byte over[6]={0xFF,0xFF,0xFF,0xFF,0x1F,0};                 //33 bits
+  CHECK(LoraCodec::readVarint(over,6,&r)==0);
+  byte six[6]={0x80,0x80,0x80,0x80,0x80,0x01};               //6 bytes
+  CHECK(LoraCodec::readVarint(six,6,&r)==0);
+  byte pad[3]={0x80,0x00,0x55};                              //non minimal 0
+  CHECK((LoraCodec::readVarint(pad,3,&r)==2)&&(r==0));
+}
+
+static void zigzagExtremes()
+{
+  const long v[]={0,-1,1,-2,2,-64,63,-65,2147483647L,-2147483647L-1};
+  const unsigned long z[]={0,1,2,3,4,127,126,129,0xFFFFFFFEUL,0xFFFFFFFFUL};
+  for (int i=0;i<10;i++)
+  {
+    CHECK(LoraCodec::zigzag(v[i])==z[i]);
+    CHECK(LoraCodec::unzigzag(z[i])==v[i]);
+  }
+  const CodecField sch[]={{FldInt,0},{FldInt,0},{FldInt,0},{FldUInt,0}};
+  LoraCodec Cd(sch,4);
+  byte b[32];
+  Cd.beginEncode(b,32);
+  Cd.putInt(2147483647L);Cd.putInt(-2147483647L-1);Cd.putInt(-1);Cd.putUInt(0xFFFFFFFFUL);
+  CHECK(Cd.endEncode()==5+5+1+5);
+  CHECK(Cd.beginDecode(b,16));
+  CHECK(Cd.getInt()==2147483647L);
+  CHECK(Cd.getInt()==-2147483647L-1);
+  CHECK(Cd.getInt()==-1);
+  CHECK(Cd.getUInt()==0xFFFFFFFFUL);
+  CHECK(Cd.endDecode());
+}
+
+static void fixedPoint()
+{
+  const CodecField sch[]={{FldFixed,0},{FldFixed,1},{FldFixed,2},{FldFixed,6},{FldFixed,1}};
+  LoraCodec Cd(sch,5);
+  byte b[32];
+  Cd.beginEncode(b,32);
+  Cd.putFloat(-3.6);Cd.putFloat(21.46);Cd.putFloat(-12.345);Cd.putFloat(0.000001);Cd.putFloat(-0.04);
+  int n=Cd.endEncode();
+  CHECK(n>0);
+  Cd.beginDecode(b,n);
+  CHECK(Cd.getFloat()==-4);                                 //rounded
+  CHECK(fabs(Cd.getFloat()-21.5)<1e-4);
+  CHECK(fabs(Cd.getFloat()+12.35)<1e-4);
+  CHECK(fabs(Cd.getFloat()-0.000001)<1e-9);
+  CHECK(Cd.getFloat()==0);
+  CHECK(Cd.endDecode());
+  const CodecField bad[]={{FldFixed,7}};
+  LoraCodec Cb(bad,1);
+  Cb.beginEncode(b,32);
+  CHECK(!Cb.putFloat(1.0));
+  CHECK(Cb.endEncode()==-1);
+}
+
+/* 10 optional fields: 2 presence bytes; absent fields cost one bit */
+static void optionalFields()
+{
+  CodecField sch[12];
+  for (int i=0;i<10;i++) {sch[i].type=FldUInt|FldOpt;sch[i].arg=0;}
+  sch[10].type=FldInt;sch[10].arg=0;
+  sch[11].type=FldBits|FldOpt;sch[11].arg=3;
+  LoraCodec Cd(sch,12);
+  byte b[32];
+  for (int mask=0;mask<(1<<11);mask+=37)
+  {
+    Cd.beginEncode(b,32);
+    int exp=2+1;
+    for (int i=0;i<10;i++) 
+      if (mask&(1<<i)) {Cd.putUInt(1000+i);exp+=2;} else Cd.skip();
+    Cd.putInt(-5);
+    if (mask&(1<<10)) {Cd.putBits(6);exp++;} else Cd.skip();
+    int n=Cd.endEncode();
+    CHECK(n==exp);
+    CHECK(Cd.beginDecode(b,n));
+    bool ok=true;
+    for (int i=0;i<10;i++)
+    {
+      bool p=mask&(1<<i);
+      if (Cd.isPresent()!=p) ok=false;
+      unsigned long v=Cd.getUInt();
+      if (v!=(p?1000+i:0)) ok=false;
+    }
+    CHECK(ok);
+    CHECK(Cd.isPresent());
+    CHECK(Cd.getInt()==-5);
+    CHECK(Cd.getBits()==((mask&(1<<10))?6:0));
+    CHECK(Cd.endDecode());
+  }
+  Cd.beginEncode(b,32);
+  for (int i=0;i<10;i++) Cd.skip();
+  CHECK(!Cd.skip());                                       //mandatory field
+  CHECK(Cd.endEncode()==-1);
+}
+
+/* Consecutive bitfields share bytes (LSB first); any other field closes them */
+static void bitfieldPacking()
+{
+  const CodecField sch[]={{FldBits,1},{FldBits,3},{FldBits,4},{FldBits,24},{FldBits,7},
+                          {FldUInt,0},{FldBits,5}};
+  LoraCodec Cd(sch,7);
+  byte b[32];
+  Cd.beginEncode(b,32);
+  Cd.putBits(1);Cd.putBits(0x1FD);Cd.putBits(9);Cd.putBits(0xABCDEF);Cd.putBits(0x7F);
+  Cd.putUInt(5);Cd.putBits(0x13);
+  int n=Cd.endEncode();
+  CHECK(n==1+3+1+1+1);
+  CHECK(b[0]==0x9B);                                       //1 | 5<<1 | 9<<4
+  CHECK((b[1]==0xEF)&&(b[2]==0xCD)&&(b[3]==0xAB));
+  CHECK((b[4]==0x7F)&&(b[5]==5)&&(b[6]==0x13));
+  Cd.beginDecode(b,n);
+  CHECK(Cd.getBits()==1);
+  CHECK(Cd.getBits()==5);                                  //masked to 3 bits
+  CHECK(Cd.getBits()==9);
+  CHECK(Cd.getBits()==0xABCDEF);
+  CHECK(Cd.getBits()==0x7F);
+  CHECK(Cd.getUInt()==5);
+  CHECK(Cd.getBits()==0x13);
+  CHECK(Cd.endDecode());
+  const CodecField bad[]={{FldBits,25}};
+  LoraCodec Cb(bad,1);
+  Cb.beginEncode(b,32);
+  CHECK(!Cb.putBits(1));
+}
+
+static void errorCases()
+{
+  const CodecField sch[]={{FldUInt,0},{FldInt,0}};
+  LoraCodec Cd(sch,2);
+  byte b[4];
+  Cd.beginEncode(b,4);
+  CHECK(!Cd.putInt(1));                                    //wrong type
+  CHECK(Cd.endEncode()==-1);
+  Cd.beginEncode(b,4);
+  Cd.putUInt(0xFFFFFFFFUL);                                //buffer full
+  CHECK(Cd.endEncode()==-1);
+  Cd.beginEncode(b,4);
+  Cd.putUInt(1);                                           //field missing
+  CHECK(Cd.endEncode()==-1);
+  Cd.beginEncode(b,4);
+  Cd.putUInt(300);Cd.putInt(-300);
+  int n=Cd.endEncode();
+  CHECK(n==4);
+  Cd.beginDecode(b,n-1);                                   //truncated
+  Cd.getUInt();Cd.getInt();
+  CHECK(!Cd.endDecode());
+  Cd.beginDecode(b,n);
+  Cd.getUInt();
+  CHECK(!Cd.endDecode());                                  //field not read
+  Cd.getInt();
+  CHECK(Cd.endDecode());
+  CHECK(!Cd.putUInt(1));                                   //decoding
+}
+
+/* Random records of CodecBench schema: round trip and size against text */
+static void records(long nrec)
+{
+  const CodecField sch[]={{FldFixed,1},{FldUInt,0},{FldUInt|FldOpt,0},{FldBits,2},{FldInt,0}};
+  LoraCodec Cd(sch,5);
+  LORA LR;
+  byte b[32];
+  char text[64];
+  long errors=0,binlen=0,txtlen=0,binframe=0,txtframe=0;
+  for (long i=0;i<nrec;i++)
+  {
+    float temp=random(-200,400)/10.0;
+    unsigned int press=random(950,1050);
+    bool hum=random(2);
+    unsigned int humv=random(100);
+    byte st=random(4);
+    int ana=random(-1024,1024);
+    Cd.beginEncode(b,32);
+    Cd.putFloat(temp);Cd.putUInt(press);
+    if (hum) Cd.putUInt(humv); else Cd.skip();
+    Cd.putBits(st);Cd.putInt(ana);
+    int n=Cd.endEncode();
+    if (n<0) {errors++;continue;}
+    Cd.beginDecode(b,n);
+    if (fabs(Cd.getFloat()-temp)>0.05) errors++;
+    if (Cd.getUInt()!=press) errors++;
+    if (Cd.isPresent()!=hum) errors++;
+    unsigned int h=Cd.getUInt(); if (hum&&(h!=humv)) errors++;
+    if (Cd.getBits()!=st) errors++;
+    if (Cd.getInt()!=ana) errors++;
+    if (!Cd.endDecode()) errors++;
+    int l=sprintf(text,"%.1f;%u;",temp,press);
+    if (hum) l+=sprintf(&text[l],"%u",humv);
+    l+=sprintf(&text[l],";%u;%d",st,ana);
+    binlen+=n;txtlen+=l;
+    binframe+=LR.getFrameLen(n);txtframe+=LR.getFrameLen(l);
+  }
+  CHECK(errors==0);
+  printf("records %ld: round trip errors %ld\n",nrec,errors);
+  printf("mean bytes: binary %.2f text %.2f  frame: binary %.2f text %.2f\n",
+         (float)binlen/nrec,(float)txtlen/nrec,(float)binframe/nrec,(float)txtframe/nrec);
+}
+
+int main(int argc,char* argv[])
+{
+  long nrec=(argc>1)?atol(argv[1]):10000;
+  randomSeed(1);
+  varintLimits();
+  zigzagExtremes();
+  fixedPoint();
+  optionalFields();
+  bitfieldPacking();
+  errorCases();
+  records(nrec);
+  return testResult();
+}
@@ -0,0 +1,31 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* EEPROM for host builds (LoraSim): every node has its own image */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+class EEPROMClass
+{
+  public:
+  void begin(size_t n){}
+  bool commit(){return true;}
+  uint8_t read(int a);
+  void write(int a,uint8_t v);
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
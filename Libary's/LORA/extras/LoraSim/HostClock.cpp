@@ -0,0 +1,46 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include "HostClock.h"
+#include <time.h>
+
+static VirtualClock defClock;
+static HostClock* clk=&defClock;
+
+HostClock* setHostClock(HostClock* c)
+{
+  HostClock* p=clk;
+  clk=(c==0)?&defClock:c;
+  return p;
+}
+
+HostClock* getHostClock(){return clk;}
+
+static unsigned long long mono()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1000000ULL+ts.tv_nsec/1000;
+}
+
+unsigned long long RealClock::now()
+{
+  static unsigned long long t0=mono();
+  return mono()-t0;
+}
+
+void RealClock::sleep(unsigned long long us)
+{
+  struct timespec ts;
+  ts.tv_sec=us/1000000;ts.tv_nsec=(us%1000000)*1000;
+  nanosleep(&ts,0);
+}
@@ -0,0 +1,64 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* HostClock : time source of the Arduino layer in host builds.
+*  delay(), delayMicroseconds(), yield(), millis() and micros() called by
+*  library code (LORA, LoraNode, SX1278, OLEDDisplayUi...) are served by the 
+*  clock installed with setHostClock():
+*  - VirtualClock (default): delays advance time instantly, so timeouts of 
+*    seconds cost nothing and runs are repeatable;
+*  - RealClock: wall clock (steady), delays sleep;
+*  - LoraSim: the simulator clock, driven by its event queue (node time).
+*  Every clock read costs spin() (a busy wait on millis() must end).
+*/
+
+#ifndef HostClock_h
+#define HostClock_h
+
+class HostClock
+{
+  public:
+/* Time (us) */  
+  virtual unsigned long long now()=0;
+/* Wait us microseconds */  
+  virtual void sleep(unsigned long long us)=0;
+/* Time of a clock read or yield */  
+  virtual void spin(){}
+};
+
+/* Virtual time: starts from 0, delays advance it */
+class VirtualClock : public HostClock
+{
+  public:
+  VirtualClock(){t=0;}
+  unsigned long long now(){return t;}
+  void sleep(unsigned long long us){t+=us;}
+  void spin(){t++;}
+  void set(unsigned long long us){t=us;}
+  private:
+  unsigned long long t;
+};
+
+/* Wall clock (from first use) */
+class RealClock : public HostClock
+{
+  public:
+  unsigned long long now();
+  void sleep(unsigned long long us);
+};
+
+/* Install clock (NULL: default VirtualClock); returns previous one */
+HostClock* setHostClock(HostClock* c);
+HostClock* getHostClock();
+
+#endif
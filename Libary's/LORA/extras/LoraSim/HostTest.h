@@ -0,0 +1,43 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* HostTest : check harness of host test programs (CodecTest, LZTest, 
+*  StreamTest). CHECK(condition) counts a test and prints the line of a 
+*  failed one; testResult() prints "<n> tests, <m> failed" and gives the exit
+*  status (1 if any test failed). Header only: include it once per program.
+*/
+
+#ifndef HostTest_h
+#define HostTest_h
+
+#include <stdio.h>
+
+static int tests=0,fails=0;
+
+#define CHECK(c) check(c,#c,__LINE__)
+
+static void check(bool ok,const char* what,int line)
+{
+  tests++;
+  if (ok) return;
+  fails++;
+  printf("FAIL line %d: %s\n",line,what);
+}
+
+static int testResult()
+{
+  printf("%d tests, %d failed\n",tests,fails);
+  return fails?1:0;
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Round trip and robustness tests of LoraLZ on host: representative payloads
+   (configuration blob, log lines, sensor text), edge cases (empty, single 
+   byte, 255 bytes, incompressible data, output buffer too small), corrupted
+   and truncated compressed input (decompress must fail or stay inside the
+   output buffer) and LORA::decodeMess() discarding frames that can't be 
+   inflated. Ratio and host throughput are printed for every payload.
+   Build:
+     g++ -O2 -std=gnu++11 -fpermissive -I. -I../.. -o lztest LZTest.cpp
+         SimArduino.cpp LoraSim.cpp HostClock.cpp ../../[A-Z]*.cpp
+   Run: ./lztest [corruptions=20000]   (exit status 1 if any test fails)
+*/
+
+#include "LoraSim.h"
+#include <LORA.h>
+#include <time.h>
+#include "HostTest.h"
+
+#define zMax  (lzMaxLen+lzMaxLen/8+2)   //compressed worst case
+#define guard 16                        //guard bytes after output
+
+static const char* payloads[]={
+  "{\"node\":12,\"net\":2345,\"freq\":433600000,\"sf\":10,\"bw\":8,\"cr\":4,\"pwr\":2,\"ack\":1,\"batch\":500}",
+  "12:00:01 node 3 rx ok rssi -97 snr 6;12:00:11 node 3 rx ok rssi -98 snr 5;12:00:21 node 3 rx ok rssi -97 snr 6",
+  "T=21.5;H=54;P=1013;T=21.6;H=54;P=1013;T=21.6;H=55;P=1012;T=21.7;H=55;P=1012",
+  "GiveMeVal"};
+
+/* Compress and inflate in[len]: same bytes, nothing written after output */
+static int roundTrip(const byte in[],int len,bool print,const char* name)
+{
+  byte z[zMax];
+  byte u[lzMaxLen+guard];
+  int zl=LoraLZ::compress(in,len,z,zMax);
+  CHECK(zl>0);
+  if (zl<=0) return zl;
+  memset(u,0xA5,sizeof(u));
+  int ul=LoraLZ::decompress(z,zl,u,lzMaxLen);
+  CHECK((ul==len)&&(memcmp(u,in,len)==0));
+  bool gok=true;
+  for (int k=len;k<lzMaxLen+guard;k++) if (u[k]!=0xA5) gok=false;
+  CHECK(gok);
+  byte zp[zMax+16];                                   //AES padding follows
+  memcpy(zp,z,zl);memset(&zp[zl],0,16);
+  CHECK(LoraLZ::decompress(zp,zl+16,u,lzMaxLen)==len);
+  if (len>0) CHECK(LoraLZ::decompress(z,zl,u,len-1)==-1);   //output too small
+  if (zl>1) CHECK(LoraLZ::compress(in,len,z,zl-1)==-1);     //no space
+  if (!print) return zl;
+  int n=2000;
+  clock_t t0=clock();
+  for (int r=0;r<n;r++) LoraLZ::compress(in,len,z,zMax);
+  clock_t t1=clock();
+  for (int r=0;r<n;r++) LoraLZ::decompress(z,zl,u,lzMaxLen);
+  clock_t t2=clock();
+  double cs=(double)(t1-t0)/CLOCKS_PER_SEC,ds=(double)(t2-t1)/CLOCKS_PER_SEC;
+  printf("%-10s len %3d zip %3d ratio %.2f  compress %6.1f MB/s  inflate %6.1f MB/s\n",name,len,zl,
+         (float)zl/len,cs>0?len*n/cs/1e6:0,ds>0?len*n/ds/1e6:0);
+  return zl;
+}
+
+static void edgeCases()
+{
+  byte b[lzMaxLen+1];
+  byte z[zMax];
+  byte u[lzMaxLen];
+  CHECK(roundTrip(b,0,false,NULL)==1);                  //just length byte
+  b[0]='x';
+  CHECK(roundTrip(b,1,false,NULL)==3);
+  memset(b,'a',lzMaxLen);
+  CHECK(roundTrip(b,lzMaxLen,false,NULL)<8);            //long matches
+  for (int i=0;i<lzMaxLen;i++) b[i]=i%7;
+  roundTrip(b,lzMaxLen,false,NULL);
+  for (int i=0;i<lzMaxLen;i++) b[i]=random(256);        //incompressible
+  int zl=roundTrip(b,lzMaxLen,false,NULL);
+  CHECK(zl>lzMaxLen);
+  CHECK(LoraLZ::compress(b,lzMaxLen,z,lzMaxLen-1)==-1);   //as LORA::sendMess
+  CHECK(LoraLZ::compress(b,lzMaxLen+1,z,zMax)==-1);       //too long
+  CHECK(LoraLZ::decompress(z,0,u,lzMaxLen)==-1);          //empty
+  for (int n=1;n<=lzMaxLen;n++)                           //every length
+  {
+    for (int i=0;i<n;i++) b[i]="abcabdabe"[random(9)];
+    roundTrip(b,n,false,NULL);
+  }
+}
+
+/* Every truncation fails; random byte changes never write outside output */
+static void corrupted(long ncorr)
+{
+  byte z[zMax];
+  byte c[zMax];
+  byte u[lzMaxLen+guard];
+  long trunc=0,bad=0,written=0;
+  for (int p=0;p<4;p++)
+  {
+    const byte* in=(const byte*)payloads[p];
+    int len=strlen(payloads[p]);
+    int zl=LoraLZ::compress(in,len,z,zMax);
+    for (int k=0;k<zl;k++) if (LoraLZ::decompress(z,k,u,lzMaxLen)!=-1) trunc++;
+    for (long r=0;r<ncorr/4;r++)
+    {
+      memcpy(c,z,zl);
+      int nc=1+random(3);
+      for (int k=0;k<nc;k++) c[random(zl)]^=1+random(255);
+      int maxout=random(lzMaxLen+1);
+      memset(u,0xA5,sizeof(u));
+      int ul=LoraLZ::decompress(c,zl,u,maxout);
+      if ((ul<-1)||(ul>maxout)) bad++;
+      for (int k=maxout;k<lzMaxLen+guard;k++) if (u[k]!=0xA5) {written++;break;}
+    }
+  }
+  CHECK(trunc==0);
+  CHECK(bad==0);
+  CHECK(written==0);
+  for (long r=0;r<ncorr;r++)                             //random streams
+  {
+    for (int k=0;k<64;k++) c[k]=random(256);
+    memset(u,0xA5,sizeof(u));
+    int ul=LoraLZ::decompress(c,64,u,lzMaxLen);
+    if ((ul<-1)||(ul>c[0])) bad++;
+    for (int k=lzMaxLen;k<lzMaxLen+guard;k++) if (u[k]!=0xA5) {written++;break;}
+  }
+  CHECK(bad==0);
+  CHECK(written==0);
+  printf("corrupted streams %ld, truncations failed as expected: %s\n",ncorr*2,trunc?"NO":"yes");
+}
+
+/* Frame as sent by LORA::sendMess with MarkZip: dest, then encrypted marker, 
+   sender and compressed message */
+static int zipFrame(byte frame[],const byte z[],int zl)
+{
+  int nbk=(zl+3+15)/16;
+  memset(frame,0,2+nbk*16);
+  frame[0]=0x09;frame[1]=0x2B;
+  frame[2]=MarkZip|0x05;frame[3]=0x09;frame[4]=0x21;
+  memcpy(&frame[5],z,zl);
+  SX.encryptBuff(&frame[2],nbk);
+  return 2+nbk*16;
+}
+
+static void decodeFrames()
+{
+  LORA LR;
+  SX.createKey(4321);
+  byte z[zMax];
+  byte frame[2+lzMaxLen+32];
+  const byte* in=(const byte*)payloads[1];
+  int len=strlen(payloads[1]);
+  int zl=LoraLZ::compress(in,len,z,zMax);
+  int fl=zipFrame(frame,z,zl);
+  CHECK(LR.decodeMess(frame,fl)==len);
+  CHECK((LR.getReceivedMessLen()==len)&&(memcmp(LR.getMessage(),in,len)==0));
+  fl=zipFrame(frame,z,zl/2);                             //truncated
+  CHECK(LR.decodeMess(frame,fl)==-1);
+  CHECK(LR.getReceivedMessLen()==0);
+  z[0]=200;                                              //length too long
+  fl=zipFrame(frame,z,zl);
+  CHECK(LR.decodeMess(frame,fl)==-1);
+  CHECK(LR.decodeMess(frame,10)==-1);                    //shorter than a block
+}
+
+int main(int argc,char* argv[])
+{
+  long ncorr=(argc>1)?atol(argv[1]):20000;
+  randomSeed(1);
+  const char* names[]={"config","log","sensors","short"};
+  for (int p=0;p<4;p++) roundTrip((const byte*)payloads[p],strlen(payloads[p]),true,names[p]);
+  edgeCases();
+  corrupted(ncorr);
+  decodeFrames();
+  return testResult();
+}
@@ -0,0 +1,683 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+#include <algorithm>
+#include "LoraSim.h"
+
+LoraSim Sim;
+
+static const unsigned long bwhz[10]={7800,10400,15600,20800,31250,41700,62500,125000,250000,500000};
+
+static unsigned long bwHz(byte bw){if (bw>9) bw=9;return bwhz[bw];}
+
+/* Hash to gaussian (fixed value for same key: link shadowing, packet fading) */
+static unsigned long long mix(unsigned long long x)
+{
+  x+=0x9E3779B97F4A7C15ULL;
+  x=(x^(x>>30))*0xBF58476D1CE4E5B9ULL;
+  x=(x^(x>>27))*0x94D049BB133111EBULL;
+  return x^(x>>31);
+}
+
+static double hgauss(unsigned long long key)
+{
+  double u1=((mix(key)>>11)+1)*(1.0/9007199254740993.0);
+  double u2=(mix(key^0x5555555555555555ULL)>>11)*(1.0/9007199254740992.0);
+  return sqrt(-2*log(u1))*cos(6.283185307179586*u2);
+}
+
+/* Same channel and spreading factor (collision) */
+static bool clash(SimTx* a,SimTx* b)
+{
+  if (a->sf!=b->sf) return false;
+  return fabs(a->hz-b->hz)<bwHz(a->bw)/2;
+}
+
+/******************************* Virtual SX1278 ******************************/
+
+void SimRadio::reset()
+{
+  memset(reg,0,sizeof(reg));memset(lreg,0,sizeof(lreg));memset(fifo,0,sizeof(fifo));
+  reg[0x01]=0x09;reg[0x06]=0x6C;reg[0x07]=0x80;reg[0x09]=0x4F;reg[0x0A]=0x09;
+  reg[0x0B]=0x2B;reg[0x0C]=0x20;reg[0x3B]=0x02;reg[0x42]=0x12;reg[0x4D]=0x84;
+  lreg[0x0E]=0x80;lreg[0x1D]=0x72;lreg[0x1E]=0x70;lreg[0x1F]=0x64;lreg[0x21]=0x08;
+  lreg[0x22]=0x01;lreg[0x23]=0xFF;lreg[0x31]=0xC3;lreg[0x37]=0x0A;
+  reg[0x02]=0x1A;reg[0x03]=0x0B;reg[0x05]=0x52;reg[0x12]=0x15;reg[0x13]=0x0B;
+  reg[0x26]=0x03;reg[0x27]=0x93;memset(reg+0x28,0x01,8);reg[0x30]=0x90;
+  reg[0x31]=0x40;reg[0x32]=0x40;reg[0x35]=0x8F;
+  fcnt=0;fhead=0;fOver=false;fflag=0;ftx=NULL;rk=0;
+  addr=-1;rst=false;
+  mode=STDBY;tmode=Sim.now();tend=0;lk=NULL;
+}
+
+void SimRadio::resetPin(bool level)
+{
+  if (!level) {rst=true;return;}
+  if (rst) {account(Sim.now());reset();}
+}
+
+void SimRadio::select(bool on){addr=-1;}
+
+byte SimRadio::transfer(byte b)
+{
+  update(Sim.now());
+  if (addr<0) {addr=b&0x7F;wr=b&0x80;return 0;}
+  byte r=0;
+  if (wr) writeReg(addr,b); else r=readReg(addr);
+  if (addr!=0) addr=(addr+1)&0x7F;
+  return r;
+}
+
+byte SimRadio::readReg(byte a)
+{
+  if ((a==0x00)&&!lora()) return fskPop();
+  if (a==0x00) return fifo[lreg[0x0D]++];
+  if (lora())
+  {
+    if (a==0x1B)
+    {
+      float p=Sim.noise(lreg[0x1D]>>4);
+      unsigned long long t=Sim.now();
+      SimTx* tx;
+      for (int i=0;(tx=Sim.history(i))!=NULL;i++)
+      {
+        if ((tx->node==node)||(tx->start>t)||(tx->end<=t)) continue;
+        if (fabs(tx->hz-carrier())>=bwHz(lreg[0x1D]>>4)/2) continue;
+        float q=Sim.rssi(tx,this);if (q>p) p=q;
+      }
+      return constrain((int)lroundf(p)+164,0,255);
+    }
+    if (a==0x2C) return Sim.rnd()&0xFF;
+  }
+  else if (a==0x3C) return (byte)(-(int)lroundf(temp));
+  else if (a==0x3E) return 0x80|((mode==RX)?0x40:0)|((mode==TX)?0x20:0);
+  else if (a==0x3F) return ((fcnt==64)?0x80:0)|((fcnt==0)?0x40:0)|((fcnt>(reg[0x35]&0x3F))?0x20:0)
+                          |(fOver?0x10:0)|fflag;
+  else if (a==0x11) return (byte)constrain(-2*(int)lroundf((lk!=NULL)?lkRssi:Sim.noise(9)),0,255);
+  return R(a);
+}
+
+void SimRadio::writeReg(byte a,byte v)
+{
+  if ((a==0x00)&&!lora()) {fskPush(v);return;}
+  if (a==0x00) {fifo[lreg[0x0D]++]=v;return;}
+  if ((a==0x3F)&&!lora()) {if (v&0x10) {fOver=false;fcnt=0;}return;}
+  if (a==0x01) 
+  {
+    if (((v^reg[1])&0x80)&&(mode!=SLEEP)) v=(v&0x7F)|(reg[1]&0x80);
+    reg[1]=(v&0xF8)|mode;
+    setMode(v&0x07);
+    return;
+  }
+  if (a==0x42) return;
+  if (lora()&&(a==0x12)) {lreg[0x12]&=~v;return;}
+  R(a)=v;
+}
+
+/* Mode change (RegOpMode write). In FSK/OOK mode only states are kept */
+void SimRadio::setMode(byte m)
+{
+  account(Sim.now());
+  byte old=mode;
+  mode=m;reg[1]=(reg[1]&0xF8)|m;
+  if (!lora())
+  {
+    unsigned long long t=Sim.now();
+    if ((old==TX)&&(m!=TX)) 
+    {
+      if ((ftx!=NULL)&&((ftx->total==0)||(ftx->n<ftx->total))) {ftx->bad=true;ftx->end=t;}
+      ftx=NULL;fflag&=~0x08;
+    }
+    if ((old==RX)&&(m!=RX)) {lk=NULL;fflag&=~0x06;}
+    if ((m==TX)&&(old!=TX)) {ftx=Sim.transmitFsk(this);tend=ftx->end;}
+    if ((m==RX)&&(old!=RX))
+    {
+      lk=NULL;
+      SimTx* tx;
+      for (int i=0;(tx=Sim.history(i))!=NULL;i++)
+        if (tx->fsk&&(tx->node!=node)&&(tx->start<=t)&&(t<tx->lock)) {fskHeard(tx);if (lk!=NULL) break;}
+    }
+    if (m==SLEEP) fcnt=0;
+    return;
+  }
+  bool wasRx=(old==RXCONT)||(old==RXSING);
+  bool isRx=(m==RXCONT)||(m==RXSING);
+  if (wasRx&&!isRx) lk=NULL;
+  unsigned long long t=Sim.now();
+  switch (m)
+  {
+    case SLEEP: memset(fifo,0,sizeof(fifo));break;
+    case TX: 
+    {
+      if (old==TX) break;
+      byte len=lreg[0x22];
+      byte buff[256];
+      for (int i=0;i<len;i++) buff[i]=fifo[(byte)(lreg[0x0E]+i)];
+      SimTx* tx=Sim.transmit(this,buff,len);
+      tend=tx->end;
+      txFrames++;txAir+=tx->end-tx->start;
+      break;
+    }
+    case RXCONT:
+    case RXSING:
+    {
+      if (m==RXSING) tend=t+(unsigned long long)(((lreg[0x1E]&3)<<8)|lreg[0x1F])*symbol();
+      if (wasRx) break;
+      lk=NULL;
+      SimTx* tx;
+      for (int i=0;(tx=Sim.history(i))!=NULL;i++)
+        if ((tx->node!=node)&&(tx->start<=t)&&(t<tx->lock)) {tryLock(tx);if (lk!=NULL) break;}
+      break;
+    }
+    case CAD: tcad=t;tend=t+2*symbol();break;
+  }
+}
+
+/* Radio events (end of TX, CAD, reception, RX single timeout) up to t */
+void SimRadio::update(unsigned long long t)
+{
+  if (!lora())
+  {
+    if (mode==TX) fskSend(t);
+    else if (mode==RX) fskReceive(t);
+  }
+  else if (lora())
+  {
+    if ((mode==TX)&&(t>=tend)) 
+      {account(tend);setMode(STDBY);lreg[0x12]|=0x08;}
+    else if ((mode==CAD)&&(t>=tend)) 
+    {
+      account(tend);cadRuns++;
+      if (cadScan()) {lreg[0x12]|=0x01;cadHits++;}
+      lreg[0x12]|=0x04;
+      setMode(STDBY);
+    }
+    else if ((mode==RXCONT)||(mode==RXSING))
+    {
+      if ((lk!=NULL)&&(t>=lk->end))
+        {account(lk->end);deliver();if (mode==RXSING) setMode(STDBY);}
+      else if ((lk==NULL)&&(mode==RXSING)&&(t>=tend))
+        {account(tend);lreg[0x12]|=0x80;setMode(STDBY);}
+    }
+  }
+  account(t);
+}
+
+void SimRadio::account(unsigned long long t)
+{
+  if (t<=tmode) return;
+  charge+=current(mode)*(t-tmode)/1e6;
+  tmode=t;
+}
+
+/* Supply current (mA) by state (SX1276/77/78 datasheet, typical) */
+float SimRadio::current(byte m)
+{
+  switch (m)
+  {
+    case SLEEP: return 0.0002;
+    case STDBY: return 1.6;
+    case FSTX: 
+    case FSRX: return 5.8;
+    case TX: 
+    {
+      float p=outPower();
+      if (p<=7) return 20;
+      if (p<=10) return 24;
+      if (p<=13) return 29;
+      if (p<=17) return 87;
+      return 120;
+    }
+  }
+  return 11.5;
+}
+
+double SimRadio::carrier()
+{
+  unsigned long frf=((unsigned long)reg[0x06]<<16)|(reg[0x07]<<8)|reg[0x08];
+  return frf*(32000000.0/524288)*(1+ppm*1e-6);
+}
+
+float SimRadio::outPower()
+{
+  byte v=reg[0x09];
+  if (v&0x80) {float p=2+(v&0x0F);if ((reg[0x4D]&7)==7) p+=3;return p;}
+  return 10.8+0.6*((v>>4)&7)-(15-(v&0x0F));
+}
+
+unsigned long SimRadio::symbol(){return (1UL<<(lreg[0x1E]>>4))*1000000UL/bwHz(lreg[0x1D]>>4);}
+
+/* Datasheet formula (par. 4.1.1.7) */
+unsigned long SimRadio::toa(byte len)
+{
+  int sf=lreg[0x1E]>>4;
+  int cr=(lreg[0x1D]>>1)&7;
+  int ih=lreg[0x1D]&1;
+  int crc=(lreg[0x1E]>>2)&1;
+  int de=(lreg[0x26]>>3)&1;
+  unsigned long tsym=symbol();
+  long num=8L*len-4*sf+28+16*crc-20*ih;
+  long den=4*(sf-2*de);
+  long nsym=8;
+  if (num>0) nsym+=((num+den-1)/den)*(cr+4);
+  unsigned long pre=word(lreg[0x20],lreg[0x21]);
+  return (pre*4UL+17)*tsym/4+nsym*tsym;
+}
+
+/* Frame receivable with current configuration */
+bool SimRadio::match(SimTx* tx)
+{
+  if (tx->sf!=(lreg[0x1E]>>4)) return false;
+  if (tx->bw!=(lreg[0x1D]>>4)) return false;
+  if (tx->ih!=(lreg[0x1D]&1)) return false;
+  return fabs(tx->hz-carrier())<bwHz(tx->bw)/4;
+}
+
+/* Lock on frame if audible; frames already on air may corrupt it */
+void SimRadio::tryLock(SimTx* tx)
+{
+  if (!match(tx)) return;
+  float p=Sim.rssi(tx,this);
+  if (p<Sim.sensitivity(tx->sf,tx->bw)) return;
+  lk=tx;lkRssi=p;lkBad=false;
+  SimTx* o;
+  for (int i=0;(o=Sim.history(i))!=NULL;i++)
+  {
+    if ((o==tx)||(o->node==node)||(o->end<=tx->start)||(o->start>Sim.now())) continue;
+    if (clash(o,tx)&&(lkRssi-Sim.rssi(o,this)<Sim.capture)) lkBad=true;
+  }
+}
+
+/* New transmission: lock, capture or corrupt the frame being received */
+void SimRadio::heard(SimTx* tx)
+{
+  if (!lora()) {fskHeard(tx);return;}
+  if (lk!=NULL)
+  {
+    if (!clash(tx,lk)) return;
+    float p=Sim.rssi(tx,this);
+    if (match(tx)&&(p-Sim.capture>=lkRssi)&&(Sim.now()<lk->lock)) {tryLock(tx);return;}
+    if (lkRssi-p<Sim.capture) lkBad=true;
+    return;
+  }
+  if ((mode==RXCONT)||(mode==RXSING)) {tryLock(tx);if (lk!=NULL) return;}
+  if (match(tx)&&(Sim.rssi(tx,this)>=Sim.sensitivity(tx->sf,tx->bw))) rxMiss++;
+}
+
+/* Frame received: FIFO, packet registers and flags */
+void SimRadio::deliver()
+{
+  SimTx* tx=lk;
+  lk=NULL;
+  byte n=tx->ih?lreg[0x22]:tx->len;
+  byte base=lreg[0x0F];
+  for (int i=0;i<n;i++) fifo[(byte)(base+i)]=(i<tx->len)?tx->data[i]:0;
+  if (lkBad&&(n>0)) for (int k=0;k<=n/8;k++) fifo[(byte)(base+Sim.rnd()%n)]^=1<<(Sim.rnd()&7);
+  lreg[0x10]=base;lreg[0x13]=n;
+  float snr=lkRssi-Sim.noise(tx->bw);
+  lreg[0x1A]=constrain((int)lroundf(lkRssi)+164,0,255);
+  lreg[0x19]=(byte)(signed char)constrain((int)lroundf(snr*4),-128,127);
+  long fe=lround((tx->hz-carrier())*500/(0.524288*bwHz(tx->bw)/1000));
+  lreg[0x28]=(fe>>16)&0x0F;lreg[0x29]=(fe>>8)&0xFF;lreg[0x2A]=fe&0xFF;
+  byte crc=tx->ih?((lreg[0x1E]>>2)&1):tx->crc;
+  byte f=0x40;
+  if (!tx->ih) f|=0x10;
+  if (lkBad&&crc) f|=0x20;
+  lreg[0x12]|=f;
+  if (lkBad) rxErr++; else rxOk++;
+}
+
+/* Preamble or frame on air during CAD */
+bool SimRadio::cadScan()
+{
+  SimTx* tx;
+  for (int i=0;(tx=Sim.history(i))!=NULL;i++)
+  {
+    if ((tx->node==node)||(tx->start>=tend)||(tx->end<=tcad)) continue;
+    if (match(tx)&&(Sim.rssi(tx,this)>=Sim.sensitivity(tx->sf,tx->bw))) return true;
+  }
+  return false;
+}
+
+/********************************* FSK modem *********************************/
+
+unsigned long SimRadio::fskBps(){unsigned int r=word(reg[0x02],reg[0x03]);return r?32000000UL/r:0;}
+
+unsigned long SimRadio::fskRxBw()
+{
+  byte v=reg[0x12];
+  return 32000000UL/((16UL+4*((v>>3)&3))<<((v&7)+2));
+}
+
+/* Packet bytes (length byte included) from first byte (variable length) or
+   PayloadLength (fixed, max 256 here) */
+int SimRadio::fskLen(SimTx* tx)
+{
+  if (reg[0x30]&0x80) return 1+tx->data[0];
+  int n=((reg[0x31]&7)<<8)|reg[0x32];
+  return (n>256)?256:n;
+}
+
+void SimRadio::fskPush(byte v)
+{
+  if (fcnt>=64) {fOver=true;return;}
+  ff[(fhead+fcnt)&63]=v;fcnt++;
+}
+
+/* PayloadReady and CrcOk are cleared when FIFO gets empty */
+byte SimRadio::fskPop()
+{
+  if (fcnt==0) {fflag&=~0x06;return 0;}
+  byte v=ff[fhead];
+  fhead=(fhead+1)&63;fcnt--;
+  if (fcnt==0) fflag&=~0x06;
+  return v;
+}
+
+/* Byte k leaves FIFO at tp+k*bt: empty FIFO is an underrun */
+void SimRadio::fskSend(unsigned long long t)
+{
+  SimTx* tx=ftx;
+  if (tx==NULL) return;
+  while (((tx->total==0)||(tx->n<tx->total))&&(tx->tp+tx->n*tx->bt<=t))
+  {
+    if (fcnt==0) tx->bad=true;
+    tx->data[tx->n]=fskPop();
+    if (tx->n==0) 
+    {
+      tx->total=fskLen(tx);
+      tx->end=tx->tp+(unsigned long long)((tx->total+2*tx->crc)*tx->bt);
+      tend=tx->end;
+    }
+    tx->n++;
+  }
+  if ((tx->total>0)&&(tx->n>=tx->total)&&(t>=tx->end))
+  {
+    fflag|=0x08;
+    txFrames++;txAir+=tx->end-tx->start;
+    ftx=NULL;
+  }
+}
+
+/* Byte k is in FIFO at tp+(k+1)*bt (sender is brought to that time) */
+void SimRadio::fskReceive(unsigned long long t)
+{
+  SimTx* tx=lk;
+  if (tx==NULL) return;
+  SimRadio* r=Sim.radio(tx->node);
+  if (r->ftx==tx) r->update(t);
+  int total=(rk>0)?fskLen(tx):0;
+  while (((total==0)||(rk<total))&&(tx->tp+(rk+1)*tx->bt<=t))
+  {
+    if (rk>=tx->n) {rxErr++;lk=NULL;fcnt=0;return;}  //sender stopped
+    byte v=tx->data[rk];
+    if (rk==0) 
+    {
+      total=fskLen(tx);
+      if ((reg[0x30]&0x80)&&(v>reg[0x32])) {lk=NULL;return;}
+    }
+    byte af=(reg[0x30]>>1)&3;
+    if ((af!=0)&&(rk==((reg[0x30]&0x80)?1:0))&&(v!=reg[0x33])&&((af==1)||(v!=reg[0x34]))) 
+      {lk=NULL;fcnt=0;return;}
+    if (fcnt>=64) {fOver=true;rxErr++;lk=NULL;return;}
+    fskPush(v);
+    rk++;
+  }
+  unsigned long long end=tx->tp+(unsigned long long)((total+2*((reg[0x30]>>4)&1))*tx->bt);
+  if ((total==0)||(rk<total)||(t<end)) return;
+  bool bad=tx->bad||lkBad;
+  lk=NULL;
+  if (bad) rxErr++; else rxOk++;
+  if (!(reg[0x30]&0x10)) {fflag|=0x04;return;}
+  if (bad&&!(reg[0x30]&0x08)) {fcnt=0;return;}   //CRC auto clear
+  if (fcnt==0) return;   //FIFO emptied before the end: flags are cleared at once
+  fflag|=bad?0x04:0x06;
+}
+
+/* Lock on preamble: same bit rate, carrier within RX bandwidth, signal over 
+   sensitivity (noise in bit rate bandwidth + 10 dB); a packet on the same 
+   channel corrupts the one locked unless 6 dB (capture) weaker */
+void SimRadio::fskHeard(SimTx* tx)
+{
+  if (!tx->fsk) return;
+  float p=Sim.rssi(tx,this);
+  bool same=(fabs(tx->hz-carrier())<fskRxBw()/2)&&(fabs(8e6/tx->bt-fskBps())<fskBps()/50.0);
+  if (lk!=NULL)
+  {
+    if (same&&(lkRssi-p<Sim.capture)) lkBad=true;
+    return;
+  }
+  if ((mode!=RX)||!same||(Sim.now()>=tx->lock)) return;
+  if (p<-174+10*log10f(fskBps())+Sim.noiseFig+10) return;
+  lk=tx;lkRssi=p;lkBad=false;rk=0;
+}
+
+/******************************** Simulator **********************************/
+
+LoraSim::LoraSim()
+{
+  pl0=40;plExp=2.7;shadow=0;fading=0;capture=6;noiseFig=6;
+  seed=1;serialOut=false;
+  nn=0;cur=-1;tnow=0;horizon=0;rs=0;ntx=0;appDups=0;
+}
+
+int LoraSim::addNode(SimSketch setup,SimSketch loop,float x,float y)
+{
+  if (nn>=simMaxNodes) return -1;
+  if (nn==0) {memcpy(sx0,&SX,sizeof(SX1278));rs=mix(seed);}
+  Node* p=new Node;
+  p->t=tnow;p->setup=setup;p->loop=loop;
+  memset(p->eeprom,255,simEeprom);
+  p->rnd=(unsigned long)mix(seed*1000+nn)|1;
+  memcpy(p->sx,sx0,sizeof(SX1278));
+  SimRadio &r=p->radio;
+  r.node=nn;r.x=x;r.y=y;r.ppm=0;r.temp=25;
+  r.txFrames=0;r.txAir=0;r.rxOk=0;r.rxErr=0;r.rxMiss=0;r.cadRuns=0;r.cadHits=0;r.charge=0;
+  r.reset();
+  p->stack=(char*)malloc(simStackLen);
+  getcontext(&p->ctx);
+  p->ctx.uc_stack.ss_sp=p->stack;
+  p->ctx.uc_stack.ss_size=simStackLen;
+  p->ctx.uc_link=&mainCtx;
+  makecontext(&p->ctx,(void(*)())nodeMain,1,nn);
+  nd[nn]=p;
+  return nn++;
+}
+
+void LoraSim::nodeMain(int n)
+{
+  Node* p=Sim.nd[n];
+  p->setup(n);
+  for (;;) {p->loop(n);Sim.advance(simCpuUs);}
+}
+
+int LoraSim::getNodes(){return nn;}
+SimRadio* LoraSim::radio(int node){return ((node<0)||(node>=nn))?NULL:&nd[node]->radio;}
+int LoraSim::current(){return cur;}
+unsigned long long LoraSim::now(){return (cur<0)?tnow:nd[cur]->t;}
+
+/* Earliest node runs until its time passes the next event (or the end) */
+void LoraSim::run(unsigned long ms)
+{
+  unsigned long long end=tnow+ms*1000ULL;
+  HostClock* prev=setHostClock(this);
+  events=std::priority_queue<Event,std::vector<Event>,std::greater<Event> >();
+  for (int i=0;i<nn;i++) if (nd[i]->t<end) events.push(Event(nd[i]->t,i));
+  while (!events.empty())
+  {
+    Event e=events.top();
+    events.pop();
+    int k=e.second;
+    tnow=e.first;cur=k;
+    horizon=events.empty()?end:min(events.top().first,end);
+    memcpy(&SX,nd[k]->sx,sizeof(SX1278));
+    swapcontext(&mainCtx,&nd[k]->ctx);
+    memcpy(nd[k]->sx,&SX,sizeof(SX1278));
+    cur=-1;
+    if (nd[k]->t<end) events.push(Event(nd[k]->t,k));
+  }
+  tnow=end;
+  setHostClock(prev);
+  for (int i=0;i<nn;i++) nd[i]->radio.update(end);
+}
+
+void LoraSim::advance(unsigned long long us)
+{
+  if (cur<0) return;
+  Node* p=nd[cur];
+  p->t+=us;
+  if (p->t>horizon) swapcontext(&p->ctx,&mainCtx);
+}
+
+SimTx* LoraSim::transmit(SimRadio* r,byte* data,byte len)
+{
+  SimTx* tx=&txTab[ntx%simMaxTx];
+  tx->id=ntx++;
+  tx->node=r->node;
+  tx->start=now();
+  tx->end=tx->start+r->toa(len);
+  unsigned long pre=word(r->R(0x20),r->R(0x21));
+  tx->lock=tx->start+(pre>1?pre-1:0)*r->symbol();
+  tx->hz=r->carrier();
+  tx->sf=r->R(0x1E)>>4;tx->bw=r->R(0x1D)>>4;
+  tx->ih=r->R(0x1D)&1;tx->crc=(r->R(0x1E)>>2)&1;
+  tx->dbm=r->outPower();
+  tx->len=len;memcpy(tx->data,data,len);
+  tx->fsk=false;
+  for (int i=0;i<nn;i++) 
+  {
+    if (i==r->node) continue;
+    nd[i]->radio.update(tx->start);
+    nd[i]->radio.heard(tx);
+  }
+  return tx;
+}
+
+/* FSK packet: bytes are taken from sender FIFO while on air (end is known
+   when the length byte is sent) */
+SimTx* LoraSim::transmitFsk(SimRadio* r)
+{
+  SimTx* tx=&txTab[ntx%simMaxTx];
+  tx->id=ntx++;
+  tx->node=r->node;
+  tx->start=now();
+  tx->fsk=true;
+  tx->bt=8e6/r->fskBps();
+  unsigned long pre=word(r->reg[0x25],r->reg[0x26]);
+  unsigned long sync=(r->reg[0x27]&0x10)?(r->reg[0x27]&7)+1:0;
+  tx->tp=tx->start+(unsigned long long)((pre+sync)*tx->bt);
+  tx->lock=tx->start+(unsigned long long)((pre>2?pre-2:0)*tx->bt);
+  tx->end=tx->tp+(unsigned long long)(258*tx->bt);
+  tx->hz=r->carrier();
+  tx->sf=0;tx->bw=0;tx->ih=0;tx->crc=(r->reg[0x30]>>4)&1;
+  tx->dbm=r->outPower();
+  tx->len=0;tx->n=0;tx->total=0;tx->bad=false;
+  for (int i=0;i<nn;i++) 
+  {
+    if (i==r->node) continue;
+    nd[i]->radio.update(tx->start);
+    nd[i]->radio.heard(tx);
+  }
+  return tx;
+}
+
+SimTx* LoraSim::history(int i)
+{
+  unsigned long n=(ntx<simMaxTx)?ntx:simMaxTx;
+  if ((i<0)||((unsigned long)i>=n)) return NULL;
+  return &txTab[(ntx-1-i)%simMaxTx];
+}
+
+float LoraSim::linkLoss(int a,int b)
+{
+  SimRadio &ra=nd[a]->radio,&rb=nd[b]->radio;
+  float d=hypotf(ra.x-rb.x,ra.y-rb.y);
+  if (d<1) d=1;
+  float pl=pl0+10*plExp*log10f(d);
+  if (shadow>0) pl+=shadow*hgauss(seed*0x10000ULL+std::min(a,b)*simMaxNodes+std::max(a,b));
+  return pl;
+}
+
+float LoraSim::rssi(SimTx* tx,SimRadio* r)
+{
+  float p=tx->dbm-linkLoss(tx->node,r->node);
+  if (fading>0) p+=fading*hgauss(~(seed*0x10000ULL)^(tx->id*simMaxNodes+r->node));
+  return p;
+}
+
+float LoraSim::noise(byte bw){return -174+10*log10f(bwHz(bw))+noiseFig;}
+
+/* Demodulator SNR limit: -5 dB (SF6) to -20 dB (SF12) */
+float LoraSim::sensitivity(byte sf,byte bw){return noise(bw)+10-2.5*sf;}
+
+unsigned long LoraSim::rnd()
+{
+  rs^=rs>>12;rs^=rs<<25;rs^=rs>>27;
+  return (unsigned long)((rs*0x2545F4914F6CDD1DULL)>>32);
+}
+
+double LoraSim::gauss(){return hgauss(rnd()*0x100000000ULL+rnd());}
+
+static byte ee0[simEeprom];
+static unsigned long rnd0=1;
+static std::string line0;
+
+byte* LoraSim::eeprom(){return (cur<0)?ee0:nd[cur]->eeprom;}
+unsigned long* LoraSim::rndState(){return (cur<0)?&rnd0:&nd[cur]->rnd;}
+std::string* LoraSim::serialLine(){return (cur<0)?&line0:&nd[cur]->line;}
+
+/**************************** Application metrics ****************************/
+
+void LoraSim::appSent(unsigned long tag){appTab[tag]=now();}
+
+void LoraSim::appDelivered(unsigned long tag)
+{
+  std::map<unsigned long,unsigned long long>::iterator it=appTab.find(tag);
+  if (it==appTab.end()) return;
+  if (it->second==~0ULL) {appDups++;return;}
+  appLat.push_back((now()-it->second)/1000.0);
+  it->second=~0ULL;
+}
+
+static float pct(std::vector<float> &v,float p)
+{
+  if (v.empty()) return 0;
+  size_t i=(size_t)(p*(v.size()-1)+0.5);
+  return v[i];
+}
+
+void LoraSim::report(FILE* f)
+{
+  double sec=tnow/1e6;
+  fprintf(f,"LoraSim: %d nodes, %.1f s, seed %lu\n",nn,sec,seed);
+  fprintf(f,"node      tx   air(ms)  duty%%    rx_ok  rx_err   missed     cad cad_hit  energy(mJ)\n");
+  unsigned long long air=0;
+  unsigned long rxe=0;
+  double en=0;
+  for (int i=0;i<nn;i++)
+  {
+    SimRadio &r=nd[i]->radio;
+    fprintf(f,"%4d %7lu %9.1f %6.2f %8lu %7lu %8lu %7lu %7lu %11.1f\n",i,r.txFrames,r.txAir/1000.0,
+      sec>0?r.txAir/1e4/sec:0,r.rxOk,r.rxErr,r.rxMiss,r.cadRuns,r.cadHits,r.charge*simVdd);
+    air+=r.txAir;rxe+=r.rxErr;en+=r.charge*simVdd;
+  }
+  std::sort(appLat.begin(),appLat.end());
+  unsigned long sent=appTab.size(),dlv=appLat.size();
+  float pdr=sent?(float)dlv/sent:0;
+  fprintf(f,"frames on air %lu, airtime %.1f ms, corrupted receptions %lu, energy %.1f mJ\n",ntx,air/1000.0,rxe,en);
+  fprintf(f,"application: sent %lu delivered %lu (%.2f%%) duplicates %lu\n",sent,dlv,pdr*100,appDups);
+  fprintf(f,"latency (ms): p50 %.1f p90 %.1f p99 %.1f max %.1f\n",pct(appLat,0.5),pct(appLat,0.9),
+    pct(appLat,0.99),appLat.empty()?0:appLat.back());
+  fprintf(f,"RESULT nodes=%d seconds=%.0f sent=%lu delivered=%lu pdr=%.4f dups=%lu p50_ms=%.1f p90_ms=%.1f "
+    "p99_ms=%.1f air_ms=%.0f frames=%lu rx_err=%lu energy_mJ=%.1f\n",nn,sec,sent,dlv,pdr,appDups,
+    pct(appLat,0.5),pct(appLat,0.9),pct(appLat,0.99),air/1000.0,ntx,rxe,en);
+}
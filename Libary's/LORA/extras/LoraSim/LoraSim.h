@@ -0,0 +1,241 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* LoraSim : discrete event simulator of a LoRa network in a Linux process.
+*  Every node runs its own sketch (setup/loop functions using unmodified
+*  library classes: LoraNode, LORA, SX1278...) as a coroutine, with its own 
+*  virtual SX1278 emulated at register level behind SPI (FIFO, modes, flags, 
+*  packet registers) and its own EEPROM, random generator and Serial.
+*  Time is virtual: the simulator is the HostClock of the Arduino layer while
+*  it runs, so delays, SPI transfers and clock reads advance the time of the
+*  node running, and an event queue (nodes by time) always runs the earliest
+*  node first, so each radio sees every transmission started before its 
+*  actions. A delay costs no host time: a day of a network runs in seconds.
+*  Channel model: time on air from radio registers, log-distance path loss 
+*  with optional shadowing (per link) and fading (per packet), sensitivity 
+*  per SF/BW, same SF collisions with capture effect, CAD detection, crystal
+*  offset (frequency error read by FEI registers). Radio energy is counted 
+*  from time spent in every state.
+*  FSK packet mode is emulated byte by byte: 64 bytes FIFO drained by the 
+*  transmitter and filled by the receiver at bit rate (underrun and overrun),
+*  FIFO flags, variable/fixed length (max 255), address filtering, CRC flags
+*  (whitening is transparent). No OOK, no DIO interrupts (flags are polled).
+*
+*  Build (from this folder, see SimNetwork.cpp for an example scenario):
+*    g++ -O2 -std=gnu++11 -fpermissive -I. -I../.. -o simnet SimNetwork.cpp LoraSim.cpp 
+*        SimArduino.cpp HostClock.cpp ../../[A-Z]*.cpp
+*/
+
+#ifndef LoraSim_h
+#define LoraSim_h
+
+#include <map>
+#include <vector>
+#include <queue>
+#include <ucontext.h>
+#include <Arduino.h>
+#include "HostClock.h"
+#include <SX1278.h>
+
+#define simMaxNodes  64           //max nodes
+#define simStackLen  (256*1024)   //coroutine stack of every node (bytes)
+#define simEeprom    512          //EEPROM bytes of every node
+#define simMaxTx     256          //transmissions kept in channel history
+#define simCpuUs     1            //time of every clock read (us)
+#define simVdd       3.3          //supply (energy)
+
+/* Sketch function: called with node index (0..nodes-1) */
+typedef void (*SimSketch)(int node);
+
+/* Transmission on air */
+struct SimTx
+{
+  int node;                       //sender index
+  unsigned long long start;       //us
+  unsigned long long end;         //us
+  unsigned long long lock;        //last time a receiver can lock (preamble)
+  double hz;                      //carrier (sender crystal error included)
+  byte sf,bw,ih,crc;              //frame configuration (bw code)
+  float dbm;                      //output power
+  unsigned long id;                //transmission number
+  byte len;
+  byte data[256];
+  bool fsk;                       //FSK packet (bytes taken from FIFO on air)
+  unsigned long long tp;          //FSK: payload start (us)
+  double bt;                      //FSK: byte time (us)
+  int n;                          //FSK: bytes sent
+  int total;                      //FSK: packet bytes (0: not known yet)
+  bool bad;                       //FSK: FIFO underrun or truncated
+};
+
+/* Virtual SX1278 (registers, FIFO and LoRa modem state machine) */
+class SimRadio
+{
+  public:
+  void reset();
+/* Reset pin level and SPI (chip select and byte exchange) */
+  void resetPin(bool level);
+  void select(bool on);
+  byte transfer(byte b);
+/* Process radio events up to time t (us) */
+  void update(unsigned long long t);
+/* A transmission starts (sender excluded) */
+  void heard(SimTx* tx);
+/* Actual carrier (Hz) and output power (dBm) from registers */
+  double carrier();
+  float outPower();
+/* Time on air (us) of a packet len bytes long with current registers */  
+  unsigned long toa(byte len);
+  unsigned long symbol();
+
+  int node;                       //owner index
+  float x,y;                      //position (m)
+  float ppm;                      //crystal error
+  float temp;                     //temperature (Celsius)
+
+/* Statistics */
+  unsigned long txFrames;         //frames sent
+  unsigned long long txAir;       //time on air (us)
+  unsigned long rxOk;             //frames received
+  unsigned long rxErr;            //frames received corrupted (collision)
+  unsigned long rxMiss;           //frames audible while not listening 
+  unsigned long cadRuns;          //CAD done
+  unsigned long cadHits;          //CAD detected
+  double charge;                  //mA*s
+
+  private:
+  friend class LoraSim;
+  byte reg[128];                  //common and FSK page
+  byte lreg[128];                 //LoRa page (0x0D-0x3F)
+  byte fifo[256];
+  byte ff[64];                    //FSK FIFO
+  int fcnt,fhead;
+  bool fOver;                     //FSK FIFO overrun
+  byte fflag;                     //FSK PacketSent, PayloadReady, CrcOk
+  SimTx* ftx;                     //FSK packet being sent
+  int rk;                         //FSK bytes received of lk
+  bool rst;                       //reset pin low
+  int addr;                       //SPI transaction address (-1: none)
+  bool wr;
+  byte mode;                      //current mode (RegOpMode bits 0-2)
+  unsigned long long tmode;       //time of last mode accounting
+  unsigned long long tend;        //end of TX, CAD, RX single timeout
+  unsigned long long tcad;        //CAD start
+  SimTx* lk;                      //transmission locked by receiver
+  float lkRssi;
+  bool lkBad;                     //locked frame corrupted
+  bool lora(){return reg[1]&0x80;}
+  byte& R(byte a){return ((a>=0x0D)&&(a<=0x3F)&&lora())?lreg[a]:reg[a];}
+  byte readReg(byte a);
+  void writeReg(byte a,byte v);
+  void setMode(byte m);
+  void account(unsigned long long t);
+  float current(byte m);
+  bool match(SimTx* tx);
+  void tryLock(SimTx* tx);
+  void deliver();
+  bool cadScan();
+  unsigned long fskBps();
+  unsigned long fskRxBw();
+  int fskLen(SimTx* tx);
+  void fskPush(byte v);
+  byte fskPop();
+  void fskSend(unsigned long long t);
+  void fskReceive(unsigned long long t);
+  void fskHeard(SimTx* tx);
+};
+
+/* Simulator */
+class LoraSim : public HostClock
+{
+  public:
+  LoraSim();
+/* Add node with sketch functions at position x,y (m). Return node index */
+  int addNode(SimSketch setup,SimSketch loop,float x,float y);
+  int getNodes();
+  SimRadio* radio(int node);
+/* Run all nodes for ms milliseconds of virtual time */
+  void run(unsigned long ms);
+/* Virtual time (us) of node running (or of simulation) */
+  unsigned long long now();
+/* Index of node running (-1 if none) */
+  int current();
+/* HostClock of nodes (installed by run) */
+  void sleep(unsigned long long us){advance(us);}
+  void spin(){advance(simCpuUs);}
+
+/* Application metrics: message identified by tag sent / arrived */
+  void appSent(unsigned long tag);
+  void appDelivered(unsigned long tag);
+/* Print report (rows per node, channel, application) */
+  void report(FILE* f);
+
+/* Channel model parameters */
+  float pl0;                      //path loss at 1 m (dB) (def. 40)
+  float plExp;                    //path loss exponent (def. 2.7)
+  float shadow;                   //shadowing std. dev. per link (dB) (def. 0)
+  float fading;                   //fading std. dev. per packet (dB) (def. 0)
+  float capture;                  //capture threshold (dB) (def. 6)
+  float noiseFig;                 //receiver noise figure (dB) (def. 6)
+  unsigned long seed;             //random seed (set before adding nodes)
+  bool serialOut;                 //print nodes Serial output (def. false)
+  
+/* Used by SimRadio and Arduino layer */
+  void advance(unsigned long long us);
+  SimTx* transmit(SimRadio* r,byte* data,byte len);
+  SimTx* transmitFsk(SimRadio* r);
+  SimTx* history(int i);          //i=0 last transmission
+  float rssi(SimTx* tx,SimRadio* r);
+  float noise(byte bw);
+  float sensitivity(byte sf,byte bw);
+  double gauss();
+  unsigned long rnd();
+  byte* eeprom();
+  unsigned long* rndState();
+  std::string* serialLine();       //Serial line being written
+  
+  private:
+  struct Node
+  {
+    ucontext_t ctx;
+    char* stack;
+    unsigned long long t;
+    SimSketch setup,loop;
+    SimRadio radio;
+    byte eeprom[simEeprom];
+    unsigned long rnd;
+    std::string line;
+    byte sx[sizeof(SX1278)];      //driver state (global SX)
+  };
+  static void nodeMain(int n);
+  Node* nd[simMaxNodes];
+  int nn;
+  int cur;
+  ucontext_t mainCtx;
+  unsigned long long tnow;
+  unsigned long long horizon;
+  typedef std::pair<unsigned long long,int> Event;   //node time, node
+  std::priority_queue<Event,std::vector<Event>,std::greater<Event> > events;
+  unsigned long long rs;          //simulator random state
+  SimTx txTab[simMaxTx];
+  unsigned long ntx;
+  std::map<unsigned long,unsigned long long> appTab;  //tag -> send time
+  std::vector<float> appLat;      //latencies (ms)
+  unsigned long appDups;
+  byte sx0[sizeof(SX1278)];       //driver state before start
+  float linkLoss(int a,int b);
+};
+
+extern LoraSim Sim;
+
+#endif
@@ -0,0 +1,45 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* SPI for host builds (LoraSim): bytes go to the virtual SX1278 of the node 
+   running, selected by chip select pin; every byte costs 8 clocks of the bus
+   frequency (def. 8 MHz) on the HostClock */
+
+#ifndef SPI_h
+#define SPI_h
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0
+#define MSBFIRST  1
+#define LSBFIRST  0
+
+class SPIClass
+{
+  public:
+  SPIClass(){freq=8000000;ns=0;}
+  void begin(){}
+  void end(){}
+  void setDataMode(int m){}
+  void setBitOrder(int o){}
+  void setClockDivider(int d){}
+  void setFrequency(unsigned long f){if (f>0) freq=f;}
+  uint8_t transfer(uint8_t b);
+  void transfer(void* buff,size_t n){uint8_t* b=(uint8_t*)buff;for (size_t i=0;i<n;i++) b[i]=transfer(b[i]);}
+  unsigned long freq;
+  private:
+  unsigned long ns;               //bus time not yet added to clock (ns)
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,139 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Arduino core functions for host builds: time (HostClock), SPI, EEPROM, 
+   random and Serial of the node running in LoraSim */
+
+#include "LoraSim.h"
+#include <SPI.h>
+#include <EEPROM.h>
+#include <Wire.h>
+
+HardwareSerial Serial;
+TwoWire Wire;
+#ifdef ARDUINO_ARCH_ESP32
+TwoWire Wire1;
+#endif
+SPIClass SPI;
+EEPROMClass EEPROM;
+
+/* Time (from HostClock: simulator while running, else virtual or real) */
+void delay(unsigned long ms){getHostClock()->sleep(ms*1000ULL);}
+void delayMicroseconds(unsigned int us){getHostClock()->sleep(us);}
+unsigned long millis(){HostClock* c=getHostClock();c->spin();return c->now()/1000;}
+unsigned long micros(){HostClock* c=getHostClock();c->spin();return c->now();}
+void yield(){getHostClock()->spin();}
+
+/* Random (xorshift32 per node) */
+long random(long hi)
+{
+  if (hi<=0) return 0;
+  unsigned long* s=Sim.rndState();
+  uint32_t x=*s;
+  x^=x<<13;x^=x>>17;x^=x<<5;
+  *s=x;
+  return x%hi;
+}
+
+long random(long lo,long hi){if (hi<=lo) return lo;return lo+random(hi-lo);}
+/* C library random() (used by AES key generation) replaced as well */
+long random(void) __THROW {return random(0x7FFFFFFFL);}
+void randomSeed(unsigned long s){if (s!=0) *Sim.rndState()=(uint32_t)s;}
+
+/* Pins: chip select and reset of SX1278 go to the virtual radio */
+void pinMode(uint8_t pin,uint8_t mode){}
+
+void digitalWrite(uint8_t pin,uint8_t val)
+{
+  SimRadio* r=Sim.radio(Sim.current());
+  if (r==NULL) return;
+  if (pin==ss) r->select(val==LOW);
+  else if (pin==SX1278Reset) r->resetPin(val!=LOW);
+}
+
+int digitalRead(uint8_t pin){return LOW;}
+int analogRead(uint8_t pin){return random(1024);}
+unsigned long pulseIn(uint8_t pin,uint8_t state,unsigned long tout){getHostClock()->sleep(tout);return 0;}
+void attachInterrupt(uint8_t n,void (*isr)(void),int mode){}
+void detachInterrupt(uint8_t n){}
+void noInterrupts(){}
+void interrupts(){}
+
+char* itoa(int val,char* s,int radix)
+{
+  char t[34];
+  int i=0;
+  bool neg=(val<0)&&(radix==10);
+  unsigned int v=neg?-val:val;
+  do {int d=v%radix;t[i++]=d<10?'0'+d:'a'+d-10;v/=radix;} while (v>0);
+  int j=0;
+  if (neg) s[j++]='-';
+  while (i>0) s[j++]=t[--i];
+  s[j]=0;
+  return s;
+}
+
+/* SPI and EEPROM */
+uint8_t SPIClass::transfer(uint8_t b)
+{
+  ns+=8000000000ULL/freq;
+  if (ns>=1000) {getHostClock()->sleep(ns/1000);ns%=1000;}
+  SimRadio* r=Sim.radio(Sim.current());
+  if (r==NULL) return 0;
+  return r->transfer(b);
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  getHostClock()->sleep((n*9+2)*1000000ULL/freq);
+  n=0;
+  return 0;
+}
+
+uint8_t EEPROMClass::read(int a){return Sim.eeprom()[a%simEeprom];}
+void EEPROMClass::write(int a,uint8_t v){Sim.eeprom()[a%simEeprom]=v;}
+
+/* Serial: lines (kept per node until complete) prefixed by time (s) and 
+   node index (if Sim.serialOut) */
+size_t HardwareSerial::write(uint8_t c)
+{
+  if ((!Sim.serialOut)||(c=='\r')) return 1;
+  std::string* ln=Sim.serialLine();
+  if (c!='\n') {ln->push_back(c);return 1;}
+  printf("%10.3f n%-2d %s\n",getHostClock()->now()/1e6,Sim.current(),ln->c_str());
+  ln->clear();
+  return 1;
+}
+
+size_t Print::print(long v,int base)
+{
+  if ((base==10)&&(v<0)) {size_t n=write('-');return n+print((unsigned long)-v,base);}
+  return print((unsigned long)v,base);
+}
+
+size_t Print::print(unsigned long v,int base)
+{
+  char t[66];
+  int i=0;
+  if (base<2) base=10;
+  do {int d=v%base;t[i++]=d<10?'0'+d:'A'+d-10;v/=base;} while (v>0);
+  size_t n=0;
+  while (i>0) n+=write(t[--i]);
+  return n;
+}
+
+size_t Print::print(double v,int dig)
+{
+  char t[64];
+  snprintf(t,sizeof(t),"%.*f",dig,v);
+  return print(t);
+}
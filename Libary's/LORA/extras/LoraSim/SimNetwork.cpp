@@ -0,0 +1,125 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/******************************************************************************/
+/* Example scenario for LoraSim: devices send a reading every period (+-25%)
+*  to the gateway (node 1) with acknowledge and retries (Node.setRetries()); 
+*  the gateway receives continuously. Devices are placed at random within radius from gateway.
+*  Build: see LoraSim.h (this file is the main). 
+*  Run:   ./simnet [key=value ...]
+*  Keys (default): nodes (10) hours (1) period (60 s) radius (1000 m) sf (10)
+*  retries (3) seed (1) shadow (0 dB) fading (0 dB) exp (2.7) peers (1: 
+*  sequence numbers on, gateway discards duplicates) verbose (0: 1 prints 
+*  nodes Serial output) wrap (1: regression scenario nodes=2 period=0.5 
+*  hours=12 sf=7, 16 bits sequence numbers wrap around: exit status 1 if a
+*  message is not acknowledged).
+*  The last report line (RESULT ...) is meant for scripts comparing runs.
+*/
+
+#include "LoraSim.h"
+#include <LoraNode.h>
+
+static float cfgHours=1,cfgPeriod=60,cfgRadius=1000,cfgShadow=0,cfgFading=0,cfgExp=2.7;
+static int cfgNodes=10,cfgSf=10,cfgRetries=3,cfgPeers=1,cfgVerbose=0;
+static unsigned long cfgSeed=1;
+static int cfgWrap=0;
+static unsigned long noAck=0;
+
+static LoraNode* node[simMaxNodes];
+static unsigned long count[simMaxNodes];
+
+static void begin(int n)
+{
+  node[n]=new LoraNode();
+  node[n]->setMaxDevices(6);
+  node[n]->setNodeAdd(n+1);
+  node[n]->setAutomaticAck(true);
+  node[n]->setRetries(cfgRetries);
+  node[n]->LR.setSequence(cfgPeers);
+  if (!node[n]->begin()) {Serial.println("No LoRa module!");return;}
+  node[n]->setSpreadingFactor(cfgSf);
+}
+
+/* Gateway (node index 0, address 1) */
+static void gwSetup(int n)
+{
+  begin(n);
+  if (cfgPeers) node[n]->setPeerTable(new LoraPeers(64));
+  Serial.println("Gateway started");
+}
+
+static void gwLoop(int n)
+{
+  if (!node[n]->newMessAvailable(0,1000)) return;
+  Sim.appDelivered(strtoul(node[n]->getMessage(),NULL,10));
+  Serial.print("From ");Serial.print(node[n]->getSender());
+  Serial.print(" : ");Serial.println(node[n]->getMessage());
+}
+
+/* Devices (jitter from simulator random: nodes random() share the key seed) */
+static void devSetup(int n)
+{
+  delay(Sim.rnd()%(unsigned long)(cfgPeriod*1000));
+  begin(n);
+}
+
+static void devLoop(int n)
+{
+  unsigned long tag=((unsigned long)n<<20)|count[n]++;
+  char mess[16];
+  sprintf(mess,"%lu",tag);
+  Sim.appSent(tag);
+  if (!node[n]->writeMessage(1,mess,2000)) {Serial.println("No acknowledge");noAck++;}
+  delay((unsigned long)(cfgPeriod*(750+Sim.rnd()%500)));
+}
+
+static void config(char* kv)
+{
+  char* v=strchr(kv,'=');
+  if (v==NULL) return;
+  *v++=0;
+  if (!strcmp(kv,"nodes")) cfgNodes=constrain(atoi(v),2,simMaxNodes);
+  else if (!strcmp(kv,"hours")) cfgHours=atof(v);
+  else if (!strcmp(kv,"period")) cfgPeriod=atof(v);
+  else if (!strcmp(kv,"radius")) cfgRadius=atof(v);
+  else if (!strcmp(kv,"sf")) cfgSf=atoi(v);
+  else if (!strcmp(kv,"retries")) cfgRetries=atoi(v);
+  else if (!strcmp(kv,"seed")) cfgSeed=strtoul(v,NULL,10);
+  else if (!strcmp(kv,"shadow")) cfgShadow=atof(v);
+  else if (!strcmp(kv,"fading")) cfgFading=atof(v);
+  else if (!strcmp(kv,"exp")) cfgExp=atof(v);
+  else if (!strcmp(kv,"peers")) cfgPeers=atoi(v);
+  else if (!strcmp(kv,"verbose")) cfgVerbose=atoi(v);
+  else if (!strcmp(kv,"wrap")) 
+    {cfgWrap=atoi(v);if (cfgWrap) {cfgNodes=2;cfgPeriod=0.5;cfgHours=12;cfgSf=7;}}
+  else fprintf(stderr,"Unknown key %s\n",kv);
+}
+
+int main(int argc,char* argv[])
+{
+  for (int i=1;i<argc;i++) config(argv[i]);
+  Sim.seed=cfgSeed;
+  Sim.shadow=cfgShadow;Sim.fading=cfgFading;Sim.plExp=cfgExp;
+  Sim.serialOut=cfgVerbose;
+  Sim.addNode(gwSetup,gwLoop,0,0);
+  for (int i=1;i<cfgNodes;i++)
+  {
+    float a=(Sim.rnd()%36000)*0.00017453293;
+    float d=cfgRadius*sqrt((Sim.rnd()%10000)/10000.0);
+    Sim.addNode(devSetup,devLoop,d*cos(a),d*sin(a));
+  }
+  Sim.run((unsigned long)(cfgHours*3600000));
+  Sim.report(stdout);
+  printf("acknowledge failures %lu\n",noAck);
+  if (cfgWrap&&(noAck>0)) return 1;
+  return 0;
+}
@@ -0,0 +1,58 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Unmodified example sketches PollingServer (node 1) and PolledDev (node 2)
+   on virtual time: 10 s polling cycles, 1 s and 20 s reply timeouts cost no
+   host time. Every sketch is compiled in its own namespace (with prototypes
+   as the Arduino builder adds them).
+   Build:
+     g++ -O2 -std=gnu++11 -fpermissive -I. -I../.. -o simpoll SimPolling.cpp 
+         LoraSim.cpp SimArduino.cpp HostClock.cpp ../../[A-Z]*.cpp
+   Run: ./simpoll [hours] [serial]   (def. 24 hours, serial 0)
+*/
+
+#include "LoraSim.h"
+#include "LoraNode.h"
+#include <time.h>
+
+namespace Server
+{
+  void getVal(int dev);
+  void manageMess(int dev,int val);
+  void norep(int dev);
+#include "../../examples/BasicNode/PollingServer/PollingServer.ino"
+}
+
+namespace Device
+{
+  void replay();
+#include "../../examples/BasicNode/PolledDev/PolledDev.ino"
+}
+
+void srvSetup(int n){Server::setup();}
+void srvLoop(int n){Server::loop();}
+void devSetup(int n){Device::setup();}
+void devLoop(int n){Device::loop();}
+
+int main(int argc,char** argv)
+{
+  float hours=(argc>1)?atof(argv[1]):24;
+  Sim.serialOut=(argc>2)&&(atoi(argv[2])!=0);
+  Sim.addNode(srvSetup,srvLoop,0,0);
+  Sim.addNode(devSetup,devLoop,500,0);
+  clock_t c0=clock();
+  Sim.run((unsigned long)(hours*3600000UL));
+  double host=(double)(clock()-c0)/CLOCKS_PER_SEC;
+  Sim.report(stdout);
+  printf("Simulated %.1f h in %.2f s of host time (x%.0f)\n",hours,host,hours*3600/(host>0?host:1e-6));
+  return 0;
+}
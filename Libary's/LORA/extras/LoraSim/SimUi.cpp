@@ -0,0 +1,71 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* OLEDDisplayUi on the VirtualClock (no simulator): frames, transitions and 
+   I2C flushes of an hour of display run in host time of their drawing only.
+   Build:
+     g++ -O2 -std=gnu++11 -fpermissive -DARDUINO=10805 -I. -I../.. 
+         -I../../../esp8266-oled-ssd1306-master/src -o simui SimUi.cpp
+         SimArduino.cpp LoraSim.cpp HostClock.cpp ../../[A-Z]*.cpp
+         ../../../esp8266-oled-ssd1306-master/src/OLED*.cpp
+   Run: ./simui [minutes] [real]   (real=1: wall clock, for comparison)
+*/
+
+#include "LoraSim.h"
+#include "SSD1306Wire.h"
+#include "OLEDDisplayUi.h"
+#include <time.h>
+
+SSD1306Wire display(0x3c,21,22);
+OLEDDisplayUi ui(&display);
+RealClock wall;
+unsigned long frames=0;
+
+void frame1(OLEDDisplay* d,OLEDDisplayUiState* s,int16_t x,int16_t y)
+{
+  char t[24];
+  snprintf(t,sizeof(t),"%lu s",millis()/1000);
+  d->setFont(ArialMT_Plain_16);
+  d->drawString(x+10,y+20,t);
+  frames++;
+}
+
+void frame2(OLEDDisplay* d,OLEDDisplayUiState* s,int16_t x,int16_t y)
+{
+  d->drawRect(x+4,y+4,120,56);
+  d->drawString(x+10,y+20,"LoRa");
+  frames++;
+}
+
+FrameCallback frames_cb[]={frame1,frame2};
+
+int main(int argc,char** argv)
+{
+  float minutes=(argc>1)?atof(argv[1]):60;
+  if ((argc>2)&&(atoi(argv[2])!=0)) setHostClock(&wall);
+  ui.setTargetFPS(30);
+  ui.setFrames(frames_cb,2);
+  ui.init();
+  clock_t c0=clock();
+  unsigned long long t0=getHostClock()->now();
+  unsigned long long end=t0+(unsigned long long)(minutes*60e6);
+  unsigned long updates=0;
+  while (getHostClock()->now()<end)
+  {
+    int left=ui.update();
+    updates++;
+    if (left>0) delay(left);
+  }
+  double host=(double)(clock()-c0)/CLOCKS_PER_SEC;
+  printf("%.1f min: %lu updates, %lu frames drawn, %.2f s of host CPU\n",minutes,updates,frames,host);
+  return 0;
+}
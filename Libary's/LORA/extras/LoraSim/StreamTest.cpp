@@ -0,0 +1,263 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Round trip tests of LoraStream on host: integer and float readings (steady
+   period, jitter, large steps, 32 bits extremes) coded in frames of random 
+   size and decoded, full frames, keyframe interval and resync(), lost frames
+   (decoding waits for the next keyframe), sequence wrap, peers with their 
+   own state, truncated frames and a buffer too short for the header.
+   Build:
+     g++ -O2 -std=gnu++11 -fpermissive -I. -I../.. -o streamtest StreamTest.cpp
+         SimArduino.cpp LoraSim.cpp HostClock.cpp ../../[A-Z]*.cpp
+   Run: ./streamtest [frames=5000]   (exit status 1 if any test fails)
+*/
+
+#include "LoraSim.h"
+#include <LoraStream.h>
+#include "HostTest.h"
+
+#define maxFrame 64
+
+/* Next reading of a sensor-like series: steady period with some jitter and 
+   gaps, slow drift with some large steps and extremes */
+static void reading(unsigned long* ts,long* v)
+{
+  long r=random(100);
+  *ts+=(r<80)?60:((r<95)?60+random(-3,4):60*random(2,100));
+  r=random(100);
+  if (r<60) *v+=random(-2,3);
+  else if (r<90) *v+=random(-300,301);
+  else if (r<97) *v=random(-100000,100000)*1000;
+  else *v=(r&1)?0x7FFFFFFFL:-0x7FFFFFFFL-1;
+  *v=(int32_t)*v;                              //32 bits as on the boards
+}
+
+static float freading(long i)
+{
+  long r=random(100);
+  if (r<5) return 0;
+  if (r<10) return -1e30;
+  return 20+(i%50)*0.1+random(-10,11)*0.01;
+}
+
+/* Readings coded in frames of random size (a reading that doesn't fit goes 
+   to the next frame) and decoded at once: same readings in the same order */
+static void roundTripInt(long frames)
+{
+  LoraStream Tx(StreamInt),Rx(StreamInt);
+  byte b[maxFrame];
+  unsigned long ts=1000,rts;
+  long v=0,rv;
+  long sent=0,got=0,errors=0,bytes=0;
+  bool pend=false;
+  for (long f=0;f<frames;f++)
+  {
+    int maxlen=random(10,maxFrame+1);
+    Tx.beginFrame(5,b,maxlen);
+    int n=0;
+    unsigned long t0[40];long v0[40];
+    for (int k=random(1,40);n<k;)
+    {
+      if (!pend) {reading(&ts,&v);pend=true;}
+      if (!Tx.addInt(ts,v)) break;
+      t0[n]=ts;v0[n]=v;n++;sent++;pend=false;
+    }
+    int len=Tx.endFrame();
+    bytes+=len;
+    if ((len<2)||(len>maxlen)) errors++;
+    if (Rx.beginDecode(3,b,len)!=n) {errors++;continue;}
+    for (int i=0;i<n;i++)
+    {
+      if (!Rx.nextInt(&rts,&rv)) {errors++;break;}
+      if ((rts!=t0[i])||(rv!=v0[i])) errors++;
+      got++;
+    }
+    if (Rx.nextInt(&rts,&rv)) errors++;
+  }
+  CHECK(errors==0);
+  CHECK(got==sent);
+  printf("int: %ld readings in %ld frames, %.2f bytes per reading\n",sent,frames,(float)bytes/sent);
+}
+
+static void roundTripFloat(long frames)
+{
+  LoraStream Tx(StreamFloat),Rx(StreamFloat);
+  byte b[maxFrame];
+  unsigned long ts=0,rts;
+  float rv;
+  long sent=0,errors=0,bytes=0;
+  for (long f=0;f<frames;f++)
+  {
+    Tx.beginFrame(7,b,random(12,maxFrame+1));
+    int n=0;
+    unsigned long t0[40];float v0[40];
+    while (n<40)
+    {
+      float v=freading(sent+n);
+      if (!Tx.addFloat(ts+60,v)) break;
+      ts+=60;t0[n]=ts;v0[n]=v;n++;
+    }
+    sent+=n;
+    int len=Tx.endFrame();
+    bytes+=len;
+    if (Rx.beginDecode(7,b,len)!=n) {errors++;continue;}
+    for (int i=0;i<n;i++)
+      if (!Rx.nextFloat(&rts,&rv)||(rts!=t0[i])||memcmp(&rv,&v0[i],4)) errors++;
+  }
+  CHECK(errors==0);
+  CHECK(!Tx.addInt(1,1));                      //wrong type
+  printf("float: %ld readings in %ld frames, %.2f bytes per reading\n",sent,frames,(float)bytes/sent);
+}
+
+/* A keyframe reading takes 8 bytes: a 10 bytes frame holds only one */
+static void fullFrame()
+{
+  LoraStream St(StreamInt);
+  byte b[16];
+  St.beginFrame(2,b,10);
+  CHECK(St.addInt(100,5));
+  CHECK(!St.addInt(160,5));
+  CHECK(St.endFrame()==10);
+  CHECK(b[1]==1);
+  St.beginFrame(2,b,4);                        //10 bits, then 2 bits each
+  int n=0;
+  while (St.addInt(160+60*n,5)) n++;
+  CHECK(n==4);
+  CHECK(St.endFrame()==4);
+}
+
+/* Buffer too short for the header: no frame, buffer not written */
+static void shortBuffer()
+{
+  LoraStream St(StreamInt);
+  byte b[4]={0xAA,0xBB,0xCC,0xDD};
+  St.beginFrame(2,b,1);
+  CHECK(!St.addInt(100,5));
+  CHECK(St.endFrame()==0);
+  CHECK((b[0]==0xAA)&&(b[1]==0xBB));
+  St.beginFrame(2,b,0);
+  CHECK(St.endFrame()==0);
+  CHECK(St.endFrame()==0);                     //no frame started
+  CHECK(St.beginDecode(2,b,1)==-1);
+}
+
+/* Keyframe every n frames and after resync() */
+static void keyframes()
+{
+  LoraStream St(StreamInt);
+  St.setKeyInterval(4);
+  byte b[maxFrame];
+  bool ok=true;
+  for (int f=0;f<12;f++)
+  {
+    St.beginFrame(9,b,maxFrame);
+    St.addInt(f*60,f);
+    St.endFrame();
+    if (((b[0]>>7)!=((f%4)==0))||((b[0]&0x7F)!=f)) ok=false;
+  }
+  CHECK(ok);
+  St.resync(9);
+  St.beginFrame(9,b,maxFrame);
+  St.endFrame();
+  CHECK(b[0]&0x80);
+  St.beginFrame(9,b,maxFrame);
+  St.endFrame();
+  CHECK(!(b[0]&0x80));
+}
+
+/* Frames of 3 readings for peer 4, one in every fr[] */
+static void code(LoraStream &St,byte fr[][maxFrame],int* len,int nf,long base)
+{
+  for (int f=0;f<nf;f++)
+  {
+    St.beginFrame(4,fr[f],maxFrame);
+    for (int i=0;i<3;i++) St.addInt((f*3+i)*60,base+f*10+i);
+    len[f]=St.endFrame();
+  }
+}
+
+static bool decodeFrame(LoraStream &St,int peer,byte* b,int len,int f,long base)
+{
+  if (St.beginDecode(peer,b,len)!=3) return false;
+  unsigned long ts;long v;
+  for (int i=0;i<3;i++)
+    if (!St.nextInt(&ts,&v)||(ts!=(unsigned long)(f*3+i)*60)||(v!=base+f*10+i)) return false;
+  return !St.nextInt(&ts,&v);
+}
+
+/* Lost frame: following frames are refused until the next keyframe */
+static void lostFrame()
+{
+  LoraStream Tx(StreamInt),Rx(StreamInt);
+  Tx.setKeyInterval(4);
+  static byte fr[12][maxFrame];
+  int len[12];
+  code(Tx,fr,len,12,1000);
+  CHECK(decodeFrame(Rx,4,fr[0],len[0],0,1000));
+  CHECK(decodeFrame(Rx,4,fr[1],len[1],1,1000));
+  CHECK(Rx.beginDecode(4,fr[3],len[3])==-1);   //frame 2 lost
+  unsigned long ts;long v;
+  CHECK(!Rx.nextInt(&ts,&v));
+  CHECK(Rx.beginDecode(4,fr[2],len[2])==-1);   //late frame too
+  CHECK(decodeFrame(Rx,4,fr[4],len[4],4,1000));   //keyframe
+  CHECK(decodeFrame(Rx,4,fr[5],len[5],5,1000));
+  CHECK(Rx.beginDecode(4,fr[5],len[5])==-1);   //duplicate
+  CHECK(decodeFrame(Rx,4,fr[8],len[8],8,1000));   //keyframe
+}
+
+/* Sequence wraps at 128; peers keep their own state */
+static void peersAndWrap()
+{
+  LoraStream Tx(StreamInt),Rx(StreamInt);
+  Tx.setKeyInterval(255);
+  byte b[maxFrame];
+  int errors=0;
+  for (int f=0;f<300;f++)
+    for (int p=1;p<=3;p++)
+    {
+      Tx.beginFrame(p,b,maxFrame);
+      for (int i=0;i<3;i++) Tx.addInt((f*3+i)*60,p*100000L+f*10+i);
+      int len=Tx.endFrame();
+      if (!decodeFrame(Rx,p,b,len,f,p*100000L)) errors++;
+    }
+  CHECK(errors==0);
+}
+
+/* Truncated frame: decoding stops, no reading past the end, state lost */
+static void truncated()
+{
+  LoraStream Tx(StreamInt),Rx(StreamInt);
+  static byte fr[2][maxFrame];
+  int len[2];
+  code(Tx,fr,len,2,-50);
+  CHECK(Rx.beginDecode(4,fr[0],len[0]-3)==3);
+  unsigned long ts;long v;
+  int n=0;
+  while (Rx.nextInt(&ts,&v)) n++;
+  CHECK(n<3);
+  CHECK(Rx.beginDecode(4,fr[1],len[1])==-1);
+}
+
+int main(int argc,char* argv[])
+{
+  long frames=(argc>1)?atol(argv[1]):5000;
+  randomSeed(1);
+  shortBuffer();
+  fullFrame();
+  keyframes();
+  lostFrame();
+  peersAndWrap();
+  truncated();
+  roundTripInt(frames);
+  roundTripFloat(frames);
+  return testResult();
+}
@@ -0,0 +1,163 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Replay of a BusTrace dump (serial monitor log with "BT:" lines, from a 
+   board or a simulation).
+   Model: transactions, bytes and bus time of every bus from clock frequency
+   (SPI: 8 clocks per byte + cs us per transaction; I2C: 9 clocks per byte 
+   with device address + start/stop).
+   Driver: every SPI transaction is executed again by the SX1278 driver of 
+   this build (SPIread/SPIwrite/bursts) and every I2C transaction by Wire, on
+   the VirtualClock: the time measured includes driver waits, so a driver 
+   change is measured against the recorded workload.
+   Build:
+     g++ -O2 -std=gnu++11 -fpermissive -I. -I../.. -o tracereplay TraceReplay.cpp
+         SimArduino.cpp LoraSim.cpp HostClock.cpp ../../[A-Z]*.cpp
+   Run: ./tracereplay log.txt [spi=8000000] [i2c=700000] [cs=1] [top=8]
+        (log "-" : standard input)
+*/
+
+#include "LoraSim.h"
+#include <SPI.h>
+#include <Wire.h>
+#include <vector>
+#include <algorithm>
+
+struct BusStat
+{
+  unsigned long n,rd,bytes;
+  double model,driver;           //bus time (us)
+};
+
+std::vector<BusRecord> recs;
+unsigned long lost=0,dumps=0;
+double span=0;                   //recorded time (us)
+
+/* Parse "BT:" lines of a log */
+void load(FILE* f)
+{
+  char line[512];
+  unsigned long first=0,last=0;
+  bool open=false;
+  while (fgets(line,sizeof(line),f))
+  {
+    char* p=strstr(line,"BT:");
+    if (p==NULL) continue;
+    p+=3;
+    while (*p==' ') p++;
+    if (strncmp(p,"n=",2)==0)
+    {
+      const char* l=strstr(p,"lost=");
+      if (l) lost+=strtoul(l+5,NULL,10);
+      if (open) span+=last-first;
+      open=false;dumps++;
+      continue;
+    }
+    if (strncmp(p,"end",3)==0) continue;
+    for (;;)
+    {
+      char h[17];
+      int k=0;
+      while ((k<16)&&isxdigit((unsigned char)p[k])) {h[k]=p[k];k++;}
+      if (k<16) break;
+      h[16]=0;p+=16;
+      BusRecord r;
+      unsigned long long v=strtoull(h,NULL,16);
+      r.t=(unsigned long)(v>>32);r.bus=(v>>24)&0xFF;r.addr=(v>>16)&0xFF;r.len=v&0xFFFF;
+      if (!open) {first=r.t;open=true;}
+      last=r.t;
+      recs.push_back(r);
+    }
+  }
+  if (open) span+=(unsigned long)(last-first);
+}
+
+int main(int argc,char** argv)
+{
+  if (argc<2) {printf("use: tracereplay log.txt|- [spi=Hz] [i2c=Hz] [cs=us] [top=n]\n");return 1;}
+  unsigned long spiHz=8000000,i2cHz=700000,top=8;
+  double cs=1;
+  for (int i=2;i<argc;i++)
+  {
+    char* v=strchr(argv[i],'=');
+    if (v==NULL) continue;
+    *v++=0;
+    if (!strcmp(argv[i],"spi")) spiHz=strtoul(v,NULL,10);
+    else if (!strcmp(argv[i],"i2c")) i2cHz=strtoul(v,NULL,10);
+    else if (!strcmp(argv[i],"cs")) cs=atof(v);
+    else if (!strcmp(argv[i],"top")) top=strtoul(v,NULL,10);
+  }
+  FILE* f=strcmp(argv[1],"-")?fopen(argv[1],"r"):stdin;
+  if (f==NULL) {perror(argv[1]);return 1;}
+  load(f);
+  
+  VirtualClock vc;
+  setHostClock(&vc);
+  SPI.setFrequency(spiHz);
+  Wire.setClock(i2cHz);
+  BusStat st[3];
+  memset(st,0,sizeof(st));
+  double regTime[256];
+  unsigned long regN[256];
+  memset(regTime,0,sizeof(regTime));memset(regN,0,sizeof(regN));
+  byte buff[256];
+  memset(buff,0,sizeof(buff));
+  for (size_t i=0;i<recs.size();i++)
+  {
+    BusRecord &r=recs[i];
+    int b=r.bus&0x0F;
+    if ((b!=BusSPI)&&(b!=BusI2C)) continue;
+    BusStat &s=st[b];
+    s.n++;s.bytes+=r.len;
+    if (r.bus&TraceRead) s.rd++;
+    unsigned long long t0=vc.now();
+    if (b==BusSPI)
+    {
+      double m=r.len*8e6/spiHz+cs;
+      s.model+=m;
+      unsigned int n=(r.len>1)?r.len-1:0;
+      if (n>255) n=255;
+      if (r.bus&TraceRead) {if (n==1) SX.SPIread(r.addr);else SX.SPIreadBurst(r.addr,buff,n);}
+      else {if (n==1) SX.SPIwrite(r.addr,0);else SX.SPIwriteBurst(r.addr,buff,n);}
+      double d=vc.now()-t0;
+      s.driver+=d;
+      regTime[r.addr&0x7F]+=d;regN[r.addr&0x7F]++;
+    }
+    else
+    {
+      s.model+=((r.len+1)*9+2)*1e6/i2cHz;
+      Wire.beginTransmission(r.addr);
+      for (unsigned int k=0;k<r.len;k++) Wire.write(0);
+      Wire.endTransmission();
+      s.driver+=vc.now()-t0;
+    }
+  }
+  
+  printf("Trace: %u records in %lu dumps, %lu lost, recorded span %.3f s\n",(unsigned)recs.size(),dumps,lost,span/1e6);
+  printf("bus   transactions     reads       bytes   model(ms)  driver(ms)  busy%%\n");
+  const char* names[3]={"","SPI","I2C"};
+  for (int b=1;b<3;b++)
+  {
+    BusStat &s=st[b];
+    printf("%-4s %13lu %9lu %11lu %11.3f %11.3f %6.2f\n",names[b],s.n,s.rd,s.bytes,
+           s.model/1000,s.driver/1000,span>0?100*s.driver/span:0);
+  }
+  std::vector<int> ord;
+  for (int a=0;a<128;a++) if (regN[a]) ord.push_back(a);
+  std::sort(ord.begin(),ord.end(),[&](int x,int y){return regTime[x]>regTime[y];});
+  if (!ord.empty()) printf("SPI registers by driver time:\n");
+  for (size_t i=0;(i<ord.size())&&(i<top);i++)
+    printf("  0x%02X %9lu transactions %11.3f ms\n",ord[i],regN[ord[i]],regTime[ord[i]]/1000);
+  printf("RESULT records=%u spi_n=%lu spi_bytes=%lu spi_model_ms=%.3f spi_driver_ms=%.3f i2c_n=%lu i2c_bytes=%lu i2c_model_ms=%.3f i2c_driver_ms=%.3f\n",
+         (unsigned)recs.size(),st[1].n,st[1].bytes,st[1].model/1000,st[1].driver/1000,st[2].n,st[2].bytes,st[2].model/1000,st[2].driver/1000);
+  return 0;
+}
@@ -0,0 +1,172 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Decoder of LoraTrace dumps (serial monitor log with "ET:" lines, from a 
+   board or a simulation: LoraSim prefix "nK" gives the node).
+   Prints the timeline (time, delta, node, decoded event) and a summary:
+   events per type and intervals (transmission start to TxDone, CAD start 
+   to CadDone, acknowledge wait) with count, mean and max.
+   Build:
+     g++ -O2 -std=gnu++11 -I. -I../.. -o timeline TraceTimeline.cpp
+   Run: ./timeline log.txt [from=s] [to=s] [list=0]   (log "-" : stdin)
+*/
+
+#include <LoraTrace.h>
+#include <SX1278.h>
+#include <vector>
+#include <string>
+
+struct Ev {double t;int node;byte ev,arg;unsigned int val;};
+
+struct Span
+{
+  const char* name;
+  unsigned long n;
+  double sum,max;
+  void add(double d){n++;sum+=d;if (d>max) max=d;}
+};
+
+std::vector<Ev> evs;
+unsigned long lost=0;
+
+void load(FILE* f)
+{
+  char line[512];
+  unsigned long long base=0,prev=0;
+  bool first=true;
+  while (fgets(line,sizeof(line),f))
+  {
+    char* p=strstr(line,"ET:");
+    if (p==NULL) continue;
+    int node=-1;
+    char* q=strstr(line," n");
+    if ((q!=NULL)&&(q<p)) node=atoi(q+2);
+    p+=3;
+    while (*p==' ') p++;
+    if (strncmp(p,"n=",2)==0)
+    {
+      const char* l=strstr(p,"lost=");
+      if (l) lost+=strtoul(l+5,NULL,10);
+      base=0;first=true;
+      continue;
+    }
+    if (strncmp(p,"end",3)==0) continue;
+    for (;;)
+    {
+      char h[17];
+      int k=0;
+      while ((k<16)&&isxdigit((unsigned char)p[k])) {h[k]=p[k];k++;}
+      if (k<16) break;
+      h[16]=0;p+=16;
+      unsigned long long v=strtoull(h,NULL,16);
+      unsigned long long t=v>>32;
+      if (!first&&(t<prev)) base+=1ULL<<32;          //32 bits us wrap
+      prev=t;first=false;
+      Ev e;
+      e.t=(base+t)/1e6;e.node=node;e.ev=(v>>24)&0xFF;e.arg=(v>>16)&0xFF;e.val=v&0xFFFF;
+      evs.push_back(e);
+    }
+  }
+}
+
+const char* stateName(byte s)
+{
+  static const char* n[8]={"SLEEP","STDBY","FSTX","TX","FSRX","RXCONT","RXSING","CAD"};
+  return n[s&7];
+}
+
+std::string flags(byte b)
+{
+  static const char* n[8]={"CadDetected","FhssChange","CadDone","TxDone","ValidHeader","CrcError","RxDone","RxTimeout"};
+  std::string s;
+  for (int i=7;i>=0;i--) if (b&(1<<i)) {if (!s.empty()) s+="|";s+=n[i];}
+  return s.empty()?std::string("-"):s;
+}
+
+std::string describe(const Ev &e)
+{
+  char t[96];
+  switch (e.ev)
+  {
+    case EvState: snprintf(t,sizeof(t),"state %s",stateName(e.arg));break;
+    case EvIrq: snprintf(t,sizeof(t),"irq %s",flags(e.arg).c_str());break;
+    case EvIrqClear: snprintf(t,sizeof(t),"irq clear %s",flags(e.arg).c_str());break;
+    case EvTx: snprintf(t,sizeof(t),"tx start %u bytes",e.val);break;
+    case EvTxDone: snprintf(t,sizeof(t),"tx done %u ms",e.val);break;
+    case EvTxFail: snprintf(t,sizeof(t),"tx FAIL (no TxDone) %u ms",e.val);break;
+    case EvRx: if (e.arg) snprintf(t,sizeof(t),"rx CRC ERROR");else snprintf(t,sizeof(t),"rx %u bytes",e.val);break;
+    case EvCad: snprintf(t,sizeof(t),"cad %s",e.arg?"free":"BUSY");break;
+    case EvAckWait: snprintf(t,sizeof(t),"ack wait from %u",e.val);break;
+    case EvAckOk: snprintf(t,sizeof(t),"ack ok from %u",e.val);break;
+    case EvAckTout: snprintf(t,sizeof(t),"ack TIMEOUT from %u",e.val);break;
+    case EvQueue: snprintf(t,sizeof(t),"queue port %u (%u bytes queued)",e.arg,e.val);break;
+    case EvFlush: snprintf(t,sizeof(t),"queue flush %u frames",e.val);break;
+    case EvRetry: snprintf(t,sizeof(t),"retry to %u",e.val);break;
+    default: snprintf(t,sizeof(t),"user %u arg %u val %u",e.ev-EvUser,e.arg,e.val);
+  }
+  return t;
+}
+
+int main(int argc,char** argv)
+{
+  if (argc<2) {printf("use: timeline log.txt|- [from=s] [to=s] [list=0]\n");return 1;}
+  double from=-1,to=1e18;
+  bool list=true;
+  for (int i=2;i<argc;i++)
+  {
+    char* v=strchr(argv[i],'=');
+    if (v==NULL) continue;
+    *v++=0;
+    if (!strcmp(argv[i],"from")) from=atof(v);
+    else if (!strcmp(argv[i],"to")) to=atof(v);
+    else if (!strcmp(argv[i],"list")) list=atoi(v)!=0;
+  }
+  FILE* f=strcmp(argv[1],"-")?fopen(argv[1],"r"):stdin;
+  if (f==NULL) {perror(argv[1]);return 1;}
+  load(f);
+  
+  unsigned long cnt[256];
+  memset(cnt,0,sizeof(cnt));
+  Span tx={"tx start -> TxDone",0,0,0},cad={"CAD -> CadDone",0,0,0},ack={"ack wait",0,0,0};
+  std::vector<double> txT(256,-1),cadT(256,-1),ackT(256,-1);  //open spans per node
+  double last=-1;
+  if (list) printf("     time(s)      +dt(us) node  event\n");
+  for (size_t i=0;i<evs.size();i++)
+  {
+    Ev &e=evs[i];
+    if ((e.t<from)||(e.t>to)) continue;
+    cnt[e.ev]++;
+    int k=e.node&0xFF;
+    if (e.ev==EvTx) txT[k]=e.t;
+    if (((e.ev==EvTxDone)||(e.ev==EvTxFail))&&(txT[k]>=0)) {tx.add(e.t-txT[k]);txT[k]=-1;}
+    if ((e.ev==EvState)&&(e.arg==CAD)) cadT[k]=e.t;
+    if ((e.ev==EvIrq)&&(e.arg&(1<<CadDone))&&(cadT[k]>=0)) {cad.add(e.t-cadT[k]);cadT[k]=-1;}
+    if (e.ev==EvAckWait) ackT[k]=e.t;
+    if (((e.ev==EvAckOk)||(e.ev==EvAckTout))&&(ackT[k]>=0)) {ack.add(e.t-ackT[k]);ackT[k]=-1;}
+    if (list)
+    {
+      printf("%12.6f %12.0f ",e.t,(last<0)?0:(e.t-last)*1e6);
+      if (e.node>=0) printf("n%-3d ",e.node);else printf("     ");
+      printf(" %s\n",describe(e).c_str());
+    }
+    last=e.t;
+  }
+  
+  printf("Events: %u decoded, %lu lost\n",(unsigned)evs.size(),lost);
+  static const char* names[EvUser]={"","state","irq","irq clear","tx","tx done","tx fail","rx","cad",
+                                    "ack wait","ack ok","ack timeout","queue","flush","retry"};
+  for (int i=1;i<256;i++) if (cnt[i]) printf("  %-12s %8lu\n",(i<EvUser)?names[i]:"user",cnt[i]);
+  Span* sp[3]={&tx,&cad,&ack};
+  for (int i=0;i<3;i++) if (sp[i]->n)
+    printf("%-20s n %6lu  mean %9.3f ms  max %9.3f ms\n",sp[i]->name,sp[i]->n,sp[i]->sum/sp[i]->n*1000,sp[i]->max*1000);
+  return 0;
+}
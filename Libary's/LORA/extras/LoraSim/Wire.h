@@ -0,0 +1,42 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+*/
+
+/* Wire (I2C master) for host builds: no device, a transmission costs its
+   bus time (9 clocks per byte with address) on the HostClock */
+
+#ifndef Wire_h
+#define Wire_h
+
+#include <Arduino.h>
+
+class TwoWire
+{
+  public:
+  TwoWire(){freq=100000;n=0;}
+  void begin(){}
+  void begin(int sda,int scl){}
+  void setClock(unsigned long f){if (f>0) freq=f;}
+  void beginTransmission(uint8_t a){n=1;}
+  size_t write(uint8_t b){n++;return 1;}
+  uint8_t endTransmission(bool stop=true);
+  int available(){return 0;}
+  int read(){return -1;}
+  unsigned long freq;
+  unsigned long n;               //bytes of current transmission
+};
+
+extern TwoWire Wire;
+#ifdef ARDUINO_ARCH_ESP32
+extern TwoWire Wire1;
+#endif
+
+#endif
@@ -523,6 +523,7 @@ void OLEDDisplay::drawStringInternal(int16_t xMove, int16_t yMove, char* text, u
 
 
 void OLEDDisplay::drawString(int16_t xMove, int16_t yMove, String strUser) {
+  PROF_SCOPE(ProfDrawString);
   uint16_t lineHeight = pgm_read_byte(fontData + HEIGHT_POS);
 
   // char* text must be freed!
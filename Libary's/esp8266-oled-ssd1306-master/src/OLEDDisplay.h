@@ -63,6 +63,24 @@ private:
 
 #include "OLEDDisplayFonts.h"
 
+// Optional profiling probes of the LORA library (LoraProf.h, enabled with
+// LORA_PROFILE) and loop latency monitor (LoraWatch.h); empty when the 
+// library or the flag is missing
+#if defined(__has_include)
+#if __has_include(<LoraProf.h>)
+#include <LoraProf.h>
+#endif
+#if __has_include(<LoraWatch.h>)
+#include <LoraWatch.h>
+#endif
+#endif
+#ifndef PROF_SCOPE
+#define PROF_SCOPE(id)
+#endif
+#ifndef WATCH_SCOPE
+#define WATCH_SCOPE(point)
+#endif
+
 //#define DEBUG_OLEDDISPLAY(...) Serial.printf( __VA_ARGS__ )
 //#define DEBUG_OLEDDISPLAY(...) dprintf("%s",  __VA_ARGS__ )
 
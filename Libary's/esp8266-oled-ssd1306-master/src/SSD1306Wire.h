@@ -49,6 +49,7 @@ class SSD1306Wire : public OLEDDisplay {
       bool                _doI2cAutoInit = false;
       TwoWire*            _wire = NULL;
       int                 _frequency;
+      void                (*_traceHook)(uint8_t address, uint16_t len) = NULL;
 
   public:
 
@@ -97,6 +98,8 @@ class SSD1306Wire : public OLEDDisplay {
     }
 
     void display(void) {
+      PROF_SCOPE(ProfI2cFlush);
+      WATCH_SCOPE(WatchDisplay);
       initI2cIfNeccesary();
       const int x_offset = (128 - this->width()) / 2;
       #ifdef OLEDDISPLAY_DOUBLE_BUFFER
@@ -148,7 +151,7 @@ class SSD1306Wire : public OLEDDisplay {
             _wire->write(buffer[x + y * this->width()]);
             k++;
             if (k == 16)  {
-              _wire->endTransmission();
+              endTransmission(k + 1);
               k = 0;
             }
           }
@@ -156,7 +159,7 @@ class SSD1306Wire : public OLEDDisplay {
         }
 
         if (k != 0) {
-          _wire->endTransmission();
+          endTransmission(k + 1);
         }
       #else
 
@@ -175,7 +178,7 @@ class SSD1306Wire : public OLEDDisplay {
             i++;
           }
           i--;
-          _wire->endTransmission();
+          endTransmission(17);
         }
       #endif
     }
@@ -184,6 +187,14 @@ class SSD1306Wire : public OLEDDisplay {
       _doI2cAutoInit = doI2cAutoInit;
     }
 
+    /**
+     * Optional bus trace: hook is called after every I2C transaction with the
+     * device address and the bytes written (control byte included), NULL to stop
+     */
+    void setTraceHook(void (*hook)(uint8_t address, uint16_t len)) {
+      _traceHook = hook;
+    }
+
   private:
 	int getBufferOffset(void) {
 		return 0;
@@ -193,7 +204,12 @@ class SSD1306Wire : public OLEDDisplay {
       _wire->beginTransmission(_address);
       _wire->write(0x80);
       _wire->write(command);
+      endTransmission(2);
+    }
+
+    inline void endTransmission(uint16_t len) __attribute__((always_inline)){
       _wire->endTransmission();
+      if (_traceHook) _traceHook(_address, len);
     }
 
     void initI2cIfNeccesary() {